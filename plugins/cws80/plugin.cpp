@@ -1,13 +1,31 @@
 #include "plugin.h"
+#include "plugin/plug_requests.h"
+#include "utility/arena.h"
 #include "utility/arithmetic.h"
 #include "utility/debug.h"
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <cmath>
 
 SynthPlugin::SynthPlugin()
-    : Plugin(cws80::Param::num_params, 0, 0),  // parameters, programs, states
-      ins_(*this)
+    : Plugin(kParameterCount, 0, 0),  // parameters, programs, states
+      ins_(*this, create_transport())
 {
-    cws80::Instrument &ins = ins_;
-    ins.initialize(getSampleRate(), bufferFrames);
+    configure_engine();
+}
+
+void *SynthPlugin::operator new(size_t size)
+{
+    void *ptr = aligned_malloc(size, alignof(SynthPlugin));
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void SynthPlugin::operator delete(void *ptr) noexcept
+{
+    aligned_free(ptr);
 }
 
 const char *SynthPlugin::getLabel() const
@@ -51,6 +69,104 @@ void SynthPlugin::initParameter(u32 index, Parameter &param)
 
     switch (index) {
         EACH_PARAMETER(PARAMETER_CASE)
+    case kParameterQuality:
+        param.hints = kParameterIsAutomable|kParameterIsInteger;
+        param.name = "Quality";
+        param.symbol = "quality";
+        param.ranges.def = (int)cws80::Quality::Normal;
+        param.ranges.min = (int)cws80::Quality::Eco;
+        param.ranges.max = (int)cws80::Quality::High;
+        break;
+    case kParameterFreewheel:
+        param.hints = kParameterIsAutomable|kParameterIsBoolean|kParameterIsInteger;
+        param.name = "Freewheel";
+        param.symbol = "freewheel";
+        param.ranges.def = 0;
+        param.ranges.min = 0;
+        param.ranges.max = 1;
+        break;
+    case kParameterEngineRate:
+        param.hints = kParameterIsInteger;
+        param.name = "Engine rate";
+        param.symbol = "engine_rate";
+        param.ranges.def = (int)cws80::EngineRate::Host;
+        param.ranges.min = (int)cws80::EngineRate::Host;
+        param.ranges.max = (int)cws80::EngineRate::Hardware;
+        break;
+    case kParameterSmoothing:
+        param.hints = 0;
+        param.name = "Smoothing";
+        param.symbol = "smoothing";
+        param.unit = "ms";
+        param.ranges.def = 0;
+        param.ranges.min = 0;
+        param.ranges.max = 100;
+        break;
+    case kParameterVoiceBudget:
+        param.hints = 0;
+        param.name = "Voice budget";
+        param.symbol = "voice_budget";
+        param.unit = "%";
+        param.ranges.def = 50;
+        param.ranges.min = 0;
+        param.ranges.max = 100;
+        break;
+    case kParameterMultitimbral:
+        param.hints = kParameterIsBoolean|kParameterIsInteger;
+        param.name = "Multitimbral";
+        param.symbol = "multitimbral";
+        param.ranges.def = 0;
+        param.ranges.min = 0;
+        param.ranges.max = 1;
+        break;
+    case kParameterLockMemory:
+        param.hints = kParameterIsBoolean|kParameterIsInteger;
+        param.name = "Lock memory";
+        param.symbol = "lock_memory";
+        param.ranges.def = 0;
+        param.ranges.min = 0;
+        param.ranges.max = 1;
+        break;
+    case kParameterSharedLfos:
+        param.hints = kParameterIsBoolean|kParameterIsInteger;
+        param.name = "Shared LFOs";
+        param.symbol = "shared_lfos";
+        param.ranges.def = 0;
+        param.ranges.min = 0;
+        param.ranges.max = 1;
+        break;
+    case kParameterPolyphony:
+        param.hints = kParameterIsInteger;
+        param.name = "Polyphony";
+        param.symbol = "polyphony";
+        param.ranges.def = 8;
+        param.ranges.min = 1;
+        param.ranges.max = cws80::polymax;
+        break;
+    case kParameterTransportProcess:
+        param.hints = kParameterIsOutput|kParameterIsInteger;
+        param.name = "Transport process";
+        param.symbol = "transport_process";
+        param.ranges.def = 0;
+        param.ranges.min = 0;
+        param.ranges.max = 1 << 24;
+        break;
+    case kParameterTransportIndex:
+        param.hints = kParameterIsOutput|kParameterIsInteger;
+        param.name = "Transport index";
+        param.symbol = "transport_index";
+        param.ranges.def = 0;
+        param.ranges.min = 0;
+        param.ranges.max = 1 << 24;
+        break;
+    case kParameterTransportToken:
+        param.hints = kParameterIsOutput|kParameterIsInteger;
+        param.name = "Transport token";
+        param.symbol = "transport_token";
+        param.ranges.def = 0;
+        param.ranges.min = 0;
+        param.ranges.max = 1 << 24;
+        break;
     default:
             assert(false);
     }
@@ -61,60 +177,221 @@ void SynthPlugin::initParameter(u32 index, Parameter &param)
 float SynthPlugin::getParameterValue(u32 index) const
 {
     const cws80::Instrument &ins = ins_;
-    return ins.get_parameter(index);
+
+    switch (index) {
+    case kParameterQuality:
+        return (int)quality_;
+    case kParameterFreewheel:
+        return freewheel_;
+    case kParameterEngineRate:
+        return (int)engine_rate_;
+    case kParameterSmoothing:
+        return smoothing_;
+    case kParameterVoiceBudget:
+        return voice_budget_;
+    case kParameterMultitimbral:
+        return multitimbral_;
+    case kParameterLockMemory:
+        return lock_memory_;
+    case kParameterSharedLfos:
+        return shared_lfos_;
+    case kParameterPolyphony:
+        return polyphony_;
+    case kParameterTransportProcess:
+        return transport_.id().process;
+    case kParameterTransportIndex:
+        return transport_.id().index;
+    case kParameterTransportToken:
+        return transport_.id().token;
+    default:
+        return ins.get_parameter(index);
+    }
 }
 
 void SynthPlugin::setParameterValue(u32 index, float value)
 {
     cws80::Instrument &ins = ins_;
-    ins.set_parameter(index, value);
+
+    switch (index) {
+    case kParameterQuality:
+        quality_ = (cws80::Quality)clamp<int>(
+            value, (int)cws80::Quality::Eco, (int)cws80::Quality::High);
+        break;
+    case kParameterFreewheel:
+        freewheel_ = value > 0.5f;
+        break;
+    case kParameterEngineRate:
+        // applied with the next activation, it reinitializes the engine
+        engine_rate_ = (cws80::EngineRate)clamp<int>(
+            value, (int)cws80::EngineRate::Host, (int)cws80::EngineRate::Hardware);
+        break;
+    case kParameterSmoothing:
+        smoothing_ = clamp(value, 0.0f, 100.0f);
+        break;
+    case kParameterVoiceBudget:
+        voice_budget_ = clamp(value, 0.0f, 100.0f);
+        break;
+    case kParameterMultitimbral:
+        multitimbral_ = value > 0.5f;
+        break;
+    case kParameterLockMemory:
+        // applied with the next activation, out of the audio thread
+        lock_memory_ = value > 0.5f;
+        break;
+    case kParameterSharedLfos:
+        shared_lfos_ = value > 0.5f;
+        break;
+    case kParameterPolyphony:
+        polyphony_ = clamp<int>(value, 1, cws80::polymax);
+        break;
+    case kParameterTransportProcess:
+    case kParameterTransportIndex:
+    case kParameterTransportToken:
+        // outputs, set by the plugin only
+        break;
+    default:
+        // applied with the next cycle, the last value if several
+        ins.set_parameter(index, (i32)value);
+        break;
+    }
+}
+
+void SynthPlugin::activate()
+{
+    // a change of engine rate allocates, it is not done by the audio thread
+    if (engine_rate_ != active_engine_rate_)
+        configure_engine();
+
+    // fault the engine in before the first note, rather than during it
+    cws80::Instrument::Residency res = ins_.activate(lock_memory_);
+    debug("Activation: {} KiB in memory, {} KiB locked{}, in {:.3f} ms",
+          res.bytes / 1024, res.locked / 1024,
+          (lock_memory_ && res.locked < res.bytes) ? " (refused by the system)" : "",
+          res.time * 1e3);
+    (void)res;
+    time_first_cycle_ = true;
 }
 
 void SynthPlugin::run(const float **, float **outputs, u32 frames,
                       const MidiEvent *midiEvents, u32 midiCount)
 {
+    std::chrono::steady_clock::time_point cycleStart;
+    if (time_first_cycle_)
+        cycleStart = std::chrono::steady_clock::now();
+
     cws80::Instrument &ins = ins_;
-    std::shared_ptr<Ring_Buffer> requests_in = requests_in_.lock();
-
-    cws80::Request::T hdr;
-    if (requests_in && requests_in->peek(hdr)) {
-        cws80::RequestTraits tr(hdr.type);
-        size_t size = tr.size();
-        alignas(cws80::Request::T) u8 data[tr.max_size()];
-        if (requests_in->get(data, size))
-            ins.receive_request(*reinterpret_cast<cws80::Request::T *>(data));
-    }
+    cws80::Transport::Layout *shared = transport_.layout();
+
+    if (smoothing_ != active_smoothing_)
+        configure_smoothing();
+
+    // offline rendering always uses the best quality
+    cws80::Quality quality = freewheel_ ? cws80::Quality::High : quality_;
+    if (quality != ins.quality())
+        ins.set_quality(quality);
+
+    // offline rendering has no deadline, and never gives up voices
+    f32 budget = freewheel_ ? 0 : voice_budget_ / 100;
+    if (budget != ins.voice_budget())
+        ins.set_voice_budget(budget);
+    if (multitimbral_ != ins.multitimbral())
+        ins.set_multitimbral(multitimbral_);
+    if (shared_lfos_ != ins.shared_lfos())
+        ins.set_shared_lfos(shared_lfos_);
+    if (polyphony_ != ins.polyphony())
+        ins.set_polyphony(polyphony_);
+
+    u32 noteCount = 0;
+    if (shared)
+        noteCount = receive_requests(shared->requests, frames);
 
     float *outL = outputs[0];
     float *outR = outputs[1];
 
-    i16 bufL[bufferFrames];
-    i16 bufR[bufferFrames];
+    i16 *bufL = bufL_.get();
+    i16 *bufR = bufR_.get();
+    f32 *resL = resL_.get();
+    f32 *resR = resR_.get();
+    cws80::MidiEvent *events = events_.get();
+    const cws80::MidiEvent *notes = requestNotes_;
+    bool resampling = resampling_;
+    u32 hostFrames = hostFrames_;
 
     u32 frameIndex = 0;
     u32 midiIndex = 0;
+    u32 noteIndex = 0;
 
     const float outputGain = 4.0;
 
     while (frameIndex < frames) {
         u32 frameCount = frames - frameIndex;
-        frameCount = (frameCount < bufferFrames) ? frameCount : bufferFrames;
+        frameCount = (frameCount < hostFrames) ? frameCount : hostFrames;
 
-        while (midiIndex < midiCount) {
-            const MidiEvent &ev = midiEvents[midiIndex];
-            u32 ftime = ev.frame;
-            if (ftime >= frameIndex + frameCount)
+        u32 eventCount = 0;
+        for (;;) {
+            // the next event of the host or of the user interface
+            bool fromHost = midiIndex < midiCount &&
+                (noteIndex == noteCount || midiEvents[midiIndex].frame <= notes[noteIndex].ftime);
+            if (!fromHost && noteIndex == noteCount)
+                break;
+            u32 frame = fromHost ? midiEvents[midiIndex].frame : notes[noteIndex].ftime;
+            u32 ftime = (frame > frameIndex) ? (frame - frameIndex) : 0;
+            if (ftime >= frameCount)
+                break;
+            if (eventCount == maxEvents) {
+                // too many events, end the cycle before this time, or
+                //  after one frame if they are all at its start, so that
+                //  the next cycle takes the rest at their time
+                if (ftime > 0) {
+                    for (; eventCount > 0 && events[eventCount - 1].ftime == ftime; --eventCount) {
+                        if (is_request_note(events[eventCount - 1]))
+                            --noteIndex;
+                        else
+                            --midiIndex;
+                    }
+                    frameCount = ftime;
+                }
+                else
+                    frameCount = 1;
                 break;
-            u32 size = ev.size;
-            const u8 *data = (ev.size <= ev.kDataSize) ? ev.data : ev.dataExt;
-            ins.receive_midi(data, size, ftime - frameIndex);
-            ++midiIndex;
+            }
+            if (fromHost) {
+                const MidiEvent &ev = midiEvents[midiIndex++];
+                u32 size = ev.size;
+                const u8 *data = (ev.size <= ev.kDataSize) ? ev.data : ev.dataExt;
+                events[eventCount++] = cws80::MidiEvent{ftime, size, data};
+            }
+            else {
+                const cws80::MidiEvent &ev = notes[noteIndex++];
+                events[eventCount++] = cws80::MidiEvent{ftime, ev.len, ev.msg};
+            }
         }
 
-        ins.synthesize(bufL, bufR, frameCount);
-        for (u32 i = 0; i < frameCount; ++i) {
-            outL[frameIndex + i] = clamp(bufL[i] * (outputGain / 32768), -1.0f, +1.0f);
-            outR[frameIndex + i] = clamp(bufR[i] * (outputGain / 32768), -1.0f, +1.0f);
+        u32 engineCount = frameCount;
+        if (resampling) {
+            engineCount = resampler_.input_frames(frameCount);
+            for (u32 i = 0; i < eventCount; ++i)
+                events[i].ftime = events[i].ftime * engineCount / frameCount;
+        }
+
+        ins.synthesize(bufL, bufR, engineCount, events, eventCount);
+
+        if (!resampling) {
+            for (u32 i = 0; i < frameCount; ++i) {
+                outL[frameIndex + i] = clamp(bufL[i] * (outputGain / 32768), -1.0f, +1.0f);
+                outR[frameIndex + i] = clamp(bufR[i] * (outputGain / 32768), -1.0f, +1.0f);
+            }
+        }
+        else {
+            for (u32 i = 0; i < engineCount; ++i) {
+                resL[i] = bufL[i] * (outputGain / 32768);
+                resR[i] = bufR[i] * (outputGain / 32768);
+            }
+            resampler_.process(resL, resR, engineCount, &outL[frameIndex], &outR[frameIndex], frameCount);
+            for (u32 i = 0; i < frameCount; ++i) {
+                outL[frameIndex + i] = clamp(outL[frameIndex + i], -1.0f, +1.0f);
+                outR[frameIndex + i] = clamp(outR[frameIndex + i], -1.0f, +1.0f);
+            }
         }
 
         frameIndex += frameCount;
@@ -126,13 +403,155 @@ void SynthPlugin::run(const float **, float **outputs, u32 frames,
         const u8 *data = (ev.size <= ev.kDataSize) ? ev.data : ev.dataExt;
         ins.receive_midi(data, size, 0);
     }
+    while (noteIndex < noteCount) {
+        const cws80::MidiEvent &ev = notes[noteIndex++];
+        ins.receive_midi(ev.msg, ev.len, 0);
+    }
+
+    if (time_first_cycle_ && midiCount + noteCount > 0) {
+        f64 secs = std::chrono::duration<f64>(std::chrono::steady_clock::now() - cycleStart).count();
+        debug("First cycle with events after activation: {:.3f} ms for {} frames, {:.1f}% of real time",
+              secs * 1e3, frames, 100 * secs * getSampleRate() / frames);
+        (void)secs;
+        time_first_cycle_ = false;
+    }
+}
+
+u32 SynthPlugin::receive_requests(cws80::Shared_Ring_Buffer &requests_in, u32 frames)
+{
+    cws80::Instrument &ins = ins_;
+    cws80::MidiEvent *notes = requestNotes_;
+    u8 (*noteData)[3] = requestNoteData_;
+
+    u64 now = cws80::request_time();
+    f64 rate = getSampleRate();
+    u8 channel = ins.midi_channel() & 15;
+    u32 noteCount = 0;
+    u32 lastFrame = 0;
+
+    // notes keep the timing of the user interface, one cycle later
+    auto schedule = [&](const cws80::Request::T &req) -> bool {
+        if (noteCount == maxRequestNotes)
+            return false;
+
+        u8 status, key, velocity;
+        u64 time;
+        if (req.type == cws80::RequestType::NoteOn) {
+            auto &note = (const cws80::Request::NoteOn &)req;
+            status = 0x90;
+            key = note.key;
+            velocity = note.velocity;
+            time = note.time;
+        }
+        else {
+            auto &note = (const cws80::Request::NoteOff &)req;
+            status = 0x80;
+            key = note.key;
+            velocity = note.velocity;
+            time = note.time;
+        }
+
+        u32 frame = 0;
+        if (time != 0 && frames > 0) {
+            f64 ago = (time < now) ? ((now - time) * 1e-9 * rate) : 0;
+            frame = (ago < frames) ? (frames - 1 - (u32)ago) : 0;
+        }
+        frame = std::max(frame, lastFrame);
+        lastFrame = frame;
+
+        u8 *msg = noteData[noteCount];
+        msg[0] = status | channel;
+        msg[1] = key & 127;
+        msg[2] = velocity & 127;
+        notes[noteCount++] = cws80::MidiEvent{frame, 3, msg};
+        return true;
+    };
+
+    cws80::receive_requests(requests_in, ins, maxRequestBytes, schedule);
+    return noteCount;
+}
+
+bool SynthPlugin::is_request_note(const cws80::MidiEvent &ev) const
+{
+    const u8 *data = &requestNoteData_[0][0];
+    return ev.msg >= data && ev.msg < data + sizeof(requestNoteData_);
+}
+
+void SynthPlugin::bufferSizeChanged(u32)
+{
+    configure_engine();
+}
+
+void SynthPlugin::sampleRateChanged(double)
+{
+    configure_engine();
+}
+
+void SynthPlugin::configure_engine()
+{
+    cws80::Instrument &ins = ins_;
+    cws80::EngineRate rate = engine_rate_;
+
+    f64 hostRate = getSampleRate();
+    f64 engineRate = cws80::engine_rate_value(rate, hostRate);
+    bool resampling = engineRate != hostRate;
+
+    // process the host buffer in one cycle, whenever possible
+    u32 hostFrames = std::max<u32>(getBufferSize(), minBufferFrames);
+
+    // at most one frame more than the ratio, depending on the phase
+    u32 engineFrames = hostFrames;
+    if (resampling) {
+        resampler_.init(engineRate, hostRate);
+        engineFrames = (u32)std::ceil(hostFrames * engineRate / hostRate) + 1;
+    }
+
+    ins.initialize(engineRate, engineFrames);
+    bufL_.reset(new i16[engineFrames]);
+    bufR_.reset(new i16[engineFrames]);
+    resL_.reset(resampling ? new f32[engineFrames] : nullptr);
+    resR_.reset(resampling ? new f32[engineFrames] : nullptr);
+    if (!events_)
+        events_.reset(new cws80::MidiEvent[maxEvents]);
+    hostFrames_ = hostFrames;
+
+    engineRate_ = engineRate;
+    resampling_ = resampling;
+    active_engine_rate_ = rate;
+    configure_smoothing();
+    setLatency(resampling ? (u32)std::lround(resampler_.latency()) : 0);
+
+    debug("Engine rate {} Hz, host rate {} Hz, buffer {}", engineRate, hostRate, hostFrames);
+}
+
+cws80::BankPool::Storage *SynthPlugin::create_transport()
+{
+    cws80::Transport &transport = transport_;
+    if (!transport.create())
+        return nullptr;
+    debug("Transport \"{}\", token {}", transport.name(), transport.id().token);
+    return &transport.layout()->banks;
+}
+
+void SynthPlugin::configure_smoothing()
+{
+    cws80::Instrument &ins = ins_;
+    f32 smoothing = smoothing_;
+
+    uint frames = (uint)std::lround(smoothing * 1e-3 * engineRate_);
+    for (uint idx = 0; idx < cws80::Param::num_params; ++idx) {
+        bool continuous = cws80::Program::is_parameter_continuous(idx);
+        ins.set_parameter_ramp(idx, continuous ? frames : 0);
+    }
+
+    active_smoothing_ = smoothing;
 }
 
 // implement FxMaster
 bool SynthPlugin::emit_notification(const cws80::Notification::T &ntf)
 {
-    std::shared_ptr<Ring_Buffer> notifications_out = notifications_out_.lock();
-    if (!notifications_out)
+    cws80::Transport::Layout *shared = transport_.layout();
+    if (!shared)
         return false;
 
     cws80::NotificationTraits tr(ntf.type);
@@ -141,7 +560,7 @@ bool SynthPlugin::emit_notification(const cws80::Notification::T &ntf)
 
     //debug("Send notification {}", size);
 
-    if (!notifications_out->put(data, size))
+    if (!shared->notifications.put(data, size))
         return false;
 
     return true;
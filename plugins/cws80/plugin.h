@@ -2,18 +2,45 @@
 #include "DistrhoPlugin.hpp"
 #include "utility/types.h"
 #include "cws/cws80_ins.h"
-#include "ring_buffer.h"
+#include "dsp/resampler.h"
+#include "plugin/plug_transport.h"
 #include <memory>
 
 class SynthPlugin : public Plugin, cws80::FxMaster {
 public:
     SynthPlugin();
+    // the instrument is aligned to cache lines, which new may not respect
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr) noexcept;
 
-    std::weak_ptr<Ring_Buffer> requests_in_;
-    std::weak_ptr<Ring_Buffer> notifications_out_;
+    // plugin parameters which follow the program parameters
+    enum {
+        kParameterQuality = cws80::Param::num_params,
+        kParameterFreewheel,
+        kParameterEngineRate,
+        kParameterSmoothing,
+        kParameterVoiceBudget,
+        kParameterMultitimbral,
+        kParameterLockMemory,
+        kParameterSharedLfos,
+        kParameterPolyphony,
+        // outputs which tell the user interface where the transport is,
+        //  not saved with the session as a state would be
+        kParameterTransportProcess,
+        kParameterTransportIndex,
+        kParameterTransportToken,
+        kParameterCount,
+    };
 
 private:
-    static constexpr u32 bufferFrames = 64;
+    // smallest cycle, when the host does not tell its buffer size
+    static constexpr u32 minBufferFrames = 64;
+    // most MIDI events in a cycle
+    static constexpr u32 maxEvents = 512;
+    // most bytes of requests received in a cycle
+    static constexpr size_t maxRequestBytes = 32768;
+    // most notes of the user interface in a cycle
+    static constexpr u32 maxRequestNotes = 64;
 
 protected:
     const char *getLabel() const override;
@@ -25,15 +52,72 @@ protected:
     void initParameter(u32 index, Parameter &param) override;
     float getParameterValue(u32 index) const override;
     void setParameterValue(u32 index, float value) override;
+    void activate() override;
     void run(const float **, float **outputs, u32 frames,
              const MidiEvent *midiEvents, u32 midiCount) override;
+    void bufferSizeChanged(u32 newBufferSize) override;
+    void sampleRateChanged(double newSampleRate) override;
 
 protected:
     // implement FxMaster
     bool emit_notification(const cws80::Notification::T &ntf) override;
 
 private:
+    // messages and banks exchanged with the user interface
+    cws80::Transport transport_;
     cws80::Instrument ins_;
+    // quality selected by the user
+    cws80::Quality quality_ = cws80::Quality::Normal;
+    // whether the host renders offline, which forces the high quality
+    bool freewheel_ = false;
+    // engine rate selected by the user
+    cws80::EngineRate engine_rate_ = cws80::EngineRate::Host;
+    // engine rate the instrument is initialized for
+    cws80::EngineRate active_engine_rate_ = cws80::EngineRate::Host;
+    // sample rate of the engine
+    f64 engineRate_ = 0;
+    // duration of automation ramps selected by the user, in ms
+    f32 smoothing_ = 0;
+    // duration of automation ramps the instrument is configured for
+    f32 active_smoothing_ = 0;
+    // share of the cycle which voices may use in real time, in %, 0 for all
+    f32 voice_budget_ = 50;
+    // whether each MIDI channel plays its own part
+    bool multitimbral_ = false;
+    // whether the LFOs which do not reset are common to the voices of a part
+    bool shared_lfos_ = false;
+    // most voices sounding at once, 1..polymax
+    u32 polyphony_ = 8;
+    // whether the activation locks the memory of the engine in RAM
+    bool lock_memory_ = false;
+    // whether to time the first cycle with events after an activation
+    bool time_first_cycle_ = false;
+    // whether the engine rate differs from the host
+    bool resampling_ = false;
+    // conversion from the engine rate to the host rate
+    dsp::resampler resampler_;
+    // maximum count of host frames in a cycle
+    u32 hostFrames_ = 0;
+    // MIDI events of a cycle
+    std::unique_ptr<cws80::MidiEvent[]> events_;
+    // notes of the user interface, at frames of the current cycle
+    cws80::MidiEvent requestNotes_[maxRequestNotes];
+    u8 requestNoteData_[maxRequestNotes][3];
+    // buffers of engine frames
+    std::unique_ptr<i16[]> bufL_, bufR_;
+    std::unique_ptr<f32[]> resL_, resR_;
+
+private:
+    // initialize the instrument for the selected engine rate
+    void configure_engine();
+    // set the ramps of the continuous parameters for the selected smoothing
+    void configure_smoothing();
+    // receive the requests of the user interface, and schedule the notes
+    u32 receive_requests(cws80::Shared_Ring_Buffer &requests_in, u32 frames);
+    // create the transport, and return the storage of its banks
+    cws80::BankPool::Storage *create_transport();
+    // whether an event is a note of the user interface
+    bool is_request_note(const cws80::MidiEvent &ev) const;
 
 private:
     DISTRHO_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SynthPlugin)
@@ -14,18 +14,50 @@ SynthUI::SynthUI()
     cws80::UI &ui = ui_;
     cws80::InputDevice_DPF *idev = new cws80::InputDevice_DPF(ui);
     idev_.reset(idev);
+}
+
+SynthUI::~SynthUI()
+{
+    // give back the banks of the requests which were never sent
+    for (const std::unique_ptr<cws80::Request::T> &req : req_queue_) {
+        if (bank_pool_ && req->type == cws80::RequestType::LoadBank) {
+            uint index = static_cast<const cws80::Request::LoadBank &>(*req).index;
+            bank_pool_->release(bank_pool_->bank(index));
+        }
+    }
+}
+
+void SynthUI::connectTransport()
+{
+    // the plugin tells where its transport is, possibly in another process
+    const cws80::Transport::Id &id = transport_id_;
+    if (!id.valid() || id == transport_.id())
+        return;
 
-    SynthPlugin *fx = static_cast<SynthPlugin *>(getPluginInstancePointer());
-    notifications_in_.reset(new Ring_Buffer(65536));
-    requests_out_.reset(new Ring_Buffer(65536));
-    fx->requests_in_ = requests_out_;
-    fx->notifications_out_ = notifications_in_;
+    // a partial update may name no transport yet, retried on the next
+    cws80::Transport::Layout *shared = transport_.open(id) ? transport_.layout() : nullptr;
+    bank_pool_.reset(shared ? new cws80::BankPool(&shared->banks) : nullptr);
 }
 
 void SynthUI::parameterChanged(u32 index, float value)
 {
+    switch (index) {
+    case SynthPlugin::kParameterTransportProcess:
+        transport_id_.process = (u32)value;
+        connectTransport();
+        break;
+    case SynthPlugin::kParameterTransportIndex:
+        transport_id_.index = (u32)value;
+        connectTransport();
+        break;
+    case SynthPlugin::kParameterTransportToken:
+        transport_id_.token = (u32)value;
+        connectTransport();
+        break;
+    default:
 #warning TODO parameterChanged
-    (void)index; (void)value;
+        break;
+    }
 }
 
 #if defined(DGL_OPENGL)
@@ -52,19 +84,24 @@ void SynthUI::onCairoDisplay(const CairoGraphicsContext& context)
 void SynthUI::uiIdle()
 {
     cws80::UI &ui = ui_;
-    Ring_Buffer &notifications_in = *notifications_in_;
+    cws80::Transport::Layout *shared = transport_.layout();
     cws80::InputDevice_DPF &idev = *idev_;
 
     flushRequests();
 
-    cws80::Notification::T hdr;
-    if (notifications_in.peek(hdr)) {
+    // take everything available, directly into the slots of the UI
+    for (cws80::Notification::T hdr; shared && shared->notifications.peek(hdr);) {
+        cws80::Notification::T *slot = ui.notification_slot();
+        if (!slot) {
+            ui.process_notifications();
+            continue;
+        }
         cws80::NotificationTraits tr(hdr.type);
-        size_t size = tr.size();
-        alignas(cws80::Notification::T) u8 data[tr.max_size()];
-        if (notifications_in.get(data, size))
-            ui.receive_notification(*reinterpret_cast<cws80::Notification::T *>(data));
+        if (!shared->notifications.get(reinterpret_cast<u8 *>(slot), tr.size()))
+            break;
+        ui.commit_notification();
     }
+    ui.process_notifications();
 
     idev.flush_events();
 
@@ -121,15 +158,18 @@ void SynthUI::initDevice()
 
 void SynthUI::flushRequests()
 {
-    Ring_Buffer &requests_out = *requests_out_;
+    cws80::Transport::Layout *shared = transport_.layout();
     std::list<std::unique_ptr<cws80::Request::T>> &req_queue = req_queue_;
 
+    if (!shared)
+        return;
+
     while (!req_queue.empty()) {
         const cws80::Request::T &req = *req_queue.front();
         cws80::RequestTraits tr(req.type);
         size_t size = tr.size();
         const u8 *data = reinterpret_cast<const u8 *>(&req);
-        if (!requests_out.put(data, size))
+        if (!shared->requests.put(data, size))
             break;
         req_queue.pop_front();
     }
@@ -138,7 +178,7 @@ void SynthUI::flushRequests()
 // implement UIMaster
 void SynthUI::emit_request(const cws80::Request::T &req)
 {
-    Ring_Buffer &requests_out = *requests_out_;
+    cws80::Transport::Layout *shared = transport_.layout();
     std::list<std::unique_ptr<cws80::Request::T>> &req_queue = req_queue_;
 
     cws80::RequestTraits tr(req.type);
@@ -148,7 +188,7 @@ void SynthUI::emit_request(const cws80::Request::T &req)
     //debug("Send request {}", size);
 
     flushRequests();
-    if (!req_queue.empty() || !requests_out.put(data, size))
+    if (!shared || !req_queue.empty() || !shared->requests.put(data, size))
         req_queue.emplace_back(tr.clone(req));
 }
 
@@ -167,6 +207,11 @@ void SynthUI::end_edit(uint idx)
     editParameter(idx, false);
 }
 
+cws80::BankPool *SynthUI::bank_pool()
+{
+    return bank_pool_.get();
+}
+
 START_NAMESPACE_DISTRHO
 
 UI *createUI()
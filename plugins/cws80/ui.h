@@ -11,16 +11,14 @@ namespace cws80 { typedef GraphicsDevice_Cairo GraphicsDevice_DPF; }
 #include "ui/detail/device/dev_input_dpf.h"
 #include "ui/detail/ui_helpers_native.h"
 #include "plugin/plug_ui_master.h"
-#include "ring_buffer.h"
+#include "plugin/plug_transport.h"
 #include <list>
 #include <memory>
 
 class SynthUI : public UI, public cws80::UIMaster {
 public:
     SynthUI();
-
-    std::shared_ptr<Ring_Buffer> notifications_in_;
-    std::shared_ptr<Ring_Buffer> requests_out_;
+    ~SynthUI();
 
 protected:
     void parameterChanged(u32 index, float value) override;
@@ -39,6 +37,7 @@ protected:
 private:
     void initDevice();
     void flushRequests();
+    void connectTransport();
 
     // -------------------------------------------------------------------------------------------------------
 protected:
@@ -47,6 +46,7 @@ protected:
     void set_parameter_automated(uint idx, i32 val) override;
     void begin_edit(uint idx) override;
     void end_edit(uint idx) override;
+    cws80::BankPool *bank_pool() override;
 
 private:
     bool init_device_ = false;
@@ -55,6 +55,11 @@ private:
     std::unique_ptr<cws80::NativeUI> nat_;
     cws80::UI ui_;
     std::list<std::unique_ptr<cws80::Request::T>> req_queue_;
+    // memory shared with the plugin, possibly in another process
+    cws80::Transport transport_;
+    // the transport of the plugin, as its output parameters tell
+    cws80::Transport::Id transport_id_;
+    std::unique_ptr<cws80::BankPool> bank_pool_;
 
 private:
     DISTRHO_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SynthUI)
@@ -9,23 +9,37 @@ static constexpr uint Pan_center_idx = (Pan_table.size() - 1) / 2;
 Dca4::Dca4()
     : param_(&initial_program().misc)
 {
+    refresh();
 }
 
 void Dca4::setparam(const Param *p)
 {
     param_ = p;
+    refresh();
 }
 
-void Dca4::generate_adding(i16 *outl, i16 *outr, const i16 *in, const i8 *envp,
-                           const i8 *panmodp, uint n)
+void Dca4::refresh()
 {
     const Param &P = *param_;
 
-    uint dca4modamt = P.DCA4MODAMT;  // 0..63
-    int panmodamt = clamp<i8>(P.PANMODAMT, -63, +63);  // -63..63
+    dca4modamt_ = P.DCA4MODAMT;  // 0..63
+    panmodamt_ = clamp<i8>(P.PANMODAMT, -63, +63);  // -63..63
 
     // PAN centered at 8 and symmetric at 0
     int pan = clamp((int)P.PAN - 8, -7, +7);  // -7..+7
+    uint panidx = (int)Pan_center_idx + pan * (int)Pan_center_idx / 7;
+
+    panr_ = Pan_table[panidx];
+    panl_ = Pan_table[Pan_table.size() - 1 - panidx];
+}
+
+void Dca4::generate_adding(i16 *outl, i16 *outr, const i16 *in, const i8 *envp,
+                           const i8 *panmodp, uint n)
+{
+    uint dca4modamt = dca4modamt_;
+    int panmodamt = panmodamt_;
+    int panl = panl_;
+    int panr = panr_;
 
     for (uint i = 0; i < n; ++i) {
         int am = envp[i] * (int)dca4modamt;  // -3969..+3969
@@ -35,11 +49,6 @@ void Dca4::generate_adding(i16 *outl, i16 *outr, const i16 *in, const i8 *envp,
         (void)panmodp; (void)panmodamt;
         // panmodp[i] * panmodamt;  // -3969..+3969
 
-        uint panidx = (int)Pan_center_idx + pan * (int)Pan_center_idx / 7;
-
-        int panr = Pan_table[panidx];
-        int panl = Pan_table[511 - panidx];
-
         outl[i] += ix16(dcaout * panl);
         outr[i] += ix16(dcaout * panr);
     }
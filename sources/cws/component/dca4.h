@@ -12,11 +12,21 @@ public:
     Dca4();
     void initialize(f64 /*fs*/, uint /*bs*/) {}
     void setparam(const Param *p);
-    void reset() {}
+    // update the values derived from the parameters
+    void refresh();
+    void reset() { refresh(); }
+    // gain of the envelope, 0..63
+    uint gain() const { return dca4modamt_; }
     void generate_adding(i16 *outl, i16 *outr, const i16 *in, const i8 *envp,
                          const i8 *panmodp, uint n);
 
 private:
+    // modulation amount, 0..63
+    uint dca4modamt_ = 0;
+    // pan modulation amount, -63..63
+    int panmodamt_ = 0;
+    // gains of left and right channels
+    int panl_ = 0, panr_ = 0;
     // parameters
     const Param *param_ = nullptr;
 };
@@ -1,12 +1,11 @@
 #include "cws/component/env.h"
+#include "cws/component/rate_tables.h"
 #include "cws/component/tables.h"
 #include "utility/arithmetic.h"
 #include <algorithm>
-#include <map>
-#include <memory>
-#include <mutex>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 
 #define debug(fmt, ...)                          \
@@ -19,14 +18,6 @@
 
 namespace cws80 {
 
-///
-struct EnvConstant {
-    u32 times[64];
-    explicit EnvConstant(f64 fs);
-};
-static std::map<f64, std::unique_ptr<EnvConstant>> Env_const;
-static std::mutex Env_const_mutex;
-
 ///
 Env::Env()
     : param_(&initial_program().envs[0])
@@ -37,10 +28,7 @@ void Env::initialize(f64 fs, uint bs)
 {
     (void)bs;
 
-    std::lock_guard<std::mutex> lock(Env_const_mutex);
-    std::unique_ptr<EnvConstant> &constant = Env_const[fs];
-    if (!constant) constant.reset(new EnvConstant(fs));
-    times_ = constant->times;
+    times_ = rate_tables(fs).env_times;
 }
 
 void Env::setparam(const Param *p)
@@ -57,6 +45,7 @@ void Env::reset()
 
     state_ = State::Off;
     rel_ = false;
+    fade_ = false;
     l_ = 0;
 }
 
@@ -65,6 +54,20 @@ void Env::trigger(uint vel)
     // TODO parameters TK T1V
     (void)vel;
 
+    refresh();
+
+#ifdef debug
+    if (state_ != State::Atk)
+        debug("%s -> %s", nameof(state_), nameof(State::Atk));
+#endif
+
+    state_ = State::Atk;
+    rel_ = false;
+    fade_ = false;
+}
+
+void Env::refresh()
+{
     const Param &param = *param_;
     const u32 *times = times_;
 
@@ -84,15 +87,9 @@ void Env::trigger(uint vel)
     i32 r2 = (l2 - l1) / (i32)t2;
     i32 r3 = (l3 - l2) / (i32)t3;
     i32 r4 = -l3 / (i32)t4;
+    if (fade_ && abs(rf_) > abs(r4))
+        r4 = rf_;
 
-#ifdef debug
-    if (state_ != State::Atk)
-        debug("%s -> %s", nameof(state_), nameof(State::Atk));
-#endif
-
-    state_ = State::Atk;
-
-    rel_ = false;
     l1_ = l1;
     l2_ = l2;
     l3_ = l3;
@@ -109,11 +106,26 @@ void Env::release(uint vel)
     rel_ = true;
 }
 
+void Env::fade(uint frames)
+{
+    i32 rf = -l_ / (i32)std::max(frames, 1u);
+    rf_ = rf;
+    fade_ = true;
+    rel_ = true;
+    if (abs(rf) > abs(r4_))
+        r4_ = rf;
+}
+
 auto Env::state() const -> State
 {
     return state_;
 }
 
+i8 Env::level() const
+{
+    return ix8(l_);
+}
+
 bool Env::running() const
 {
     return state_ != State::Off;
@@ -215,11 +227,4 @@ const char *Env::nameof(State s)
     return names[(uint)s];
 }
 
-EnvConstant::EnvConstant(f64 fs)
-{
-    scoped_fesetround(FE_TONEAREST);
-    for (uint i = 0; i < 64; ++i)
-        times[i] = lrint(Env_times[i] * fs);
-}
-
 }  // namespace cws80
@@ -16,29 +16,43 @@ struct Env {
     void setparam(const Param *p);
     void reset();
     void trigger(uint vel);
+    // update the levels and slopes from the parameters
+    void refresh();
     void release(uint vel);
+    // release from the current level in the given time, or faster
+    void fade(uint frames);
     State state() const;
     bool running() const;
+    bool released() const { return rel_; }
+    bool fading() const { return fade_; }
+    // current level, range -63..+63
+    i8 level() const;
     void generate(i8 *outp, uint n);  // range -63..+63
     static f32 timeval(uint i);  // range 0..63
     static uint timeidx(f32 t);
     static const char *nameof(State s);
 
 private:
-    // parameters
-    const Param *param_ = nullptr;
+    // the state of the generator first, then the configuration
+
+    // current level
+    i32 l_ = 0;
     // which state it's currently in
     State state_ = State::Off;
     // levels in Q8,24 units
     i32 l1_ = 0, l2_ = 0, l3_ = 0;
     // slopes in Q8,24 units per sample
     i32 r1_ = 0, r2_ = 0, r3_ = 0, r4_ = 0;
-    // current level
-    i32 l_ = 0;
+    // slope of a fade, which replaces the release if steeper
+    i32 rf_ = 0;
     // whether key has been released yet
     bool rel_ = false;
+    // whether the release is a fade
+    bool fade_ = false;
+    // parameters
+    const Param *param_ = nullptr;
     // Q16,16 envelope times normalized to sample rate
-    u32 *times_ = nullptr;
+    const u32 *times_ = nullptr;
 };
 
 }  // namespace cws80
@@ -1,44 +1,35 @@
 #include "cws/component/lfo.h"
+#include "cws/component/rate_tables.h"
 #include "cws/component/tables.h"
 #include "utility/arithmetic.h"
-#include <map>
-#include <memory>
-#include <mutex>
 #include <math.h>
 
 #pragma message("TODO implement LFO: L1, L2, DELAY, MOD")
 
 namespace cws80 {
 
-///
-struct LfoConstant {
-    u32 lfo_phi[64];
-    explicit LfoConstant(f64 fs);
-};
-static std::map<f64, std::unique_ptr<LfoConstant>> Lfo_const;
-static std::mutex Lfo_const_mutex;
-
-///
-static volatile bool Lfo_wavetables_init = false;
-static std::mutex Lfo_wavetables_mutex;
-static void Lfo_generate_waves();
-static i8 Lfo_tri[256];
+// noise of a counter, the lowbias32 hash which mixes all the bits
+static inline u32 Lfo_noise_hash(u32 x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
 
 ///
 Lfo::Lfo()
     : param_(&initial_program().lfos[0])
 {
-    Lfo_generate_waves();
 }
 
 void Lfo::initialize(f64 fs, uint bs)
 {
     (void)bs;
 
-    std::lock_guard<std::mutex> lock(Lfo_const_mutex);
-    std::unique_ptr<LfoConstant> &constant = Lfo_const[fs];
-    if (!constant) constant.reset(new LfoConstant(fs));
-    lfo_phi_ = constant->lfo_phi;
+    lfo_phi_ = rate_tables(fs).lfo_phi;
 }
 
 void Lfo::setparam(const Param *p)
@@ -51,57 +42,72 @@ void Lfo::reset()
     phase_ = 0;
 }
 
+void Lfo::setseed(u32 seed)
+{
+    noiseseed_ = Lfo_noise_hash(seed);
+}
+
 void Lfo::generate(i8 *outp, const i8 *mod, uint n)
 {
     u32 phase = phase_;
 
     const Param &P = *param_;
-    auto &noisernd = noisernd_;
 #pragma message("TODO: mods (case of self modulation?)")
     (void)mod; // mod: add to LFO depth
 
     u32 phi = lfo_phi_[P.FREQ];
 
+    // the waves at full scale are -127..+127, the outputs are halved
+    //  the frames are independent, the phase of a frame is phase + i * phi
     switch ((LfoWave)P.WAV) {
     case LfoWave::TRI: {
+#pragma omp simd
         for (uint i = 0; i < n; ++i) {
-            outp[i] = Lfo_tri[ix8(phase)];
-            phase += phi;
+            int k = ix8(phase + i * phi);
+            // triangle, from 0 up to 64, down to -64, and up to 0
+            int fold = ((k + 64) & 255) - 128;
+            int tri = 64 - ((fold < 0) ? -fold : fold);
+            // tri * 127 / 64 rounded to nearest even, then halved toward 0
+            //  which is (63 * |tri| + 32) / 64 over -64..+64
+            int mag = (tri < 0) ? -tri : tri;
+            int out = (63 * mag + 32) >> 6;
+            outp[i] = (tri < 0) ? -out : out;
         }
         break;
     }
     case LfoWave::SAW: {
+#pragma omp simd
         for (uint i = 0; i < n; ++i) {
-            uint saw = 255 - ix8(phase);
-            outp[i] = (int)(saw * 254 / 255) - 127;
-            phase += phi;
+            int saw = 255 - (int)ix8(phase + i * phi);
+            // saw * 254 / 255 - 127, which is saw - 1 - 127 except for 0
+            outp[i] = (saw - (saw != 0) - 127) / 2;
         }
         break;
     }
     case LfoWave::SQR: {
-        for (uint i = 0; i < n; ++i) {
-            outp[i] = (phase < (u32)fx8(128)) ? 0 : 127;
-            phase += phi;
-        }
+#pragma omp simd
+        for (uint i = 0; i < n; ++i)
+            outp[i] = (ix8(phase + i * phi) < 128) ? 0 : 63;
         break;
     }
     case LfoWave::NOI: {
+        u32 ctr = noisectr_;
+        u32 seed = noiseseed_;
+#pragma omp simd
         for (uint i = 0; i < n; ++i) {
-            uint noi = noisernd() % 255;
-            outp[i] = (int)noi - 127;
-            phase += phi;
+            u32 noise = Lfo_noise_hash((ctr + i) ^ seed);
+            // 0..254, from the high bits
+            int noi = ((noise >> 16) * 255) >> 16;
+            outp[i] = (noi - 127) / 2;
         }
+        noisectr_ = ctr + n;
         break;
     }
     }
 
-    /* outp : -127..+127 */
-
-    for (uint i = 0; i < n; ++i) {
-        outp[i] /= 2;
-    }
+    /* outp : -63..+63 */
 
-    phase_ = phase;
+    phase_ = phase + n * phi;
 }
 
 uint Lfo::freqidx(f32 f)
@@ -114,30 +120,4 @@ uint Lfo::freqidx(f32 f)
     return (f - f0 < f1 - f) ? i : (i + 1);
 }
 
-LfoConstant::LfoConstant(f64 fs)
-{
-    scoped_fesetround(FE_TONEAREST);
-    for (uint i = 0; i < 64; ++i)
-        lfo_phi[i] = fx8(256 * Lfo_freqs[i] / fs);
-}
-
-static void Lfo_generate_waves()
-{
-    if (Lfo_wavetables_init)
-        return;
-
-    std::lock_guard<std::mutex> lock(Lfo_wavetables_mutex);
-    if (Lfo_wavetables_init)
-        return;
-
-    scoped_fesetround(FE_TONEAREST);
-
-    for (uint i = 0; i < 256; ++i) {
-        int n = clamp((int)i, 0, 64) - clamp((int)i - 64, 0, 128) +
-                clamp((int)i - 192, 0, 63);
-        f64 val = n * 127. / 64.;
-        Lfo_tri[i] = (i8)lrint(val);
-    }
-}
-
 }  // namespace cws80
@@ -3,7 +3,6 @@
 #include "cws/cws80_data.h"
 #include "utility/types.h"
 #include <memory>
-#include <random>
 
 namespace cws80 {
 
@@ -14,19 +13,22 @@ public:
     Lfo();
     void initialize(f64 fs, uint bs);
     void setparam(const Param *p);
+    // the noise is a function of the seed and of the frame count
+    void setseed(u32 seed);
     void reset();
     void generate(i8 *outp, const i8 *const mod, uint n);  // range -63..+63
     static uint freqidx(f32 f);
 
 private:
-    // parameters
-    const Param *param_ = nullptr;
     // Q8,24 phase
     u32 phase_ = 0;
-    // noise generator
-    std::minstd_rand noisernd_;
+    // frame count of the noise, and its seed
+    u32 noisectr_ = 0;
+    u32 noiseseed_ = 0;
+    // parameters
+    const Param *param_ = nullptr;
     // Q8,24 phase increments
-    u32 *lfo_phi_ = nullptr;
+    const u32 *lfo_phi_ = nullptr;
 };
 
 }  // namespace cws80
@@ -1,26 +1,126 @@
 #include "cws/component/osc.h"
+#include "cws/component/rate_tables.h"
 #include "utility/arithmetic.h"
+#include "utility/attributes.h"
 #include "utility/debug.h"
-#include <map>
-#include <memory>
-#include <mutex>
 #include <math.h>
+#include <string.h>
 
 #pragma message("TODO implement OSC")
 
 namespace cws80 {
 
-// resolution per interval of a semitone
-static constexpr uint osc_phi_oversample = 8;
-static constexpr uint osc_phi_tablen = 128 * osc_phi_oversample;
+///
+template <Quality Q> static int Osc_interpolate(const Sample &sample, u32 phase);
+
+// byte of a sample, taken out of the aligned word which holds it
+//  the vectors gather words and not bytes; a wave is a multiple of 4 long,
+//  so the word does not pass its end
+static ForceInline uint Osc_sample_byte(const Sample &sample, u32 index)
+{
+    u32 word;
+    memcpy(&word, &sample.data[index & ~3u], 4);
+    uint byte = index & 3;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    byte ^= 3;
+#endif
+    // selects, not a shift by lane, which the vector units may not have
+    word = (byte & 2) ? (word >> 16) : word;
+    word = (byte & 1) ? (word >> 8) : word;
+    return word & 255;
+}
+
+// sample value in -32767..+32767
+static ForceInline int Osc_sample_value(const Sample &sample, u32 index)
+{
+    return (int)Osc_sample_byte(sample, index) * 65534 / 255 - 32767;
+}
+
+template <> ForceInline int Osc_interpolate<Quality::Eco>(const Sample &sample, u32 phase)
+{
+    // no interpolation
+    uint index = phase >> (32 - sample.log2length);
+    return Osc_sample_value(sample, index);
+}
+
+template <> ForceInline int Osc_interpolate<Quality::Normal>(const Sample &sample, u32 phase)
+{
+    // linear interpolation
+    uint mask = (1 << sample.log2length) - 1;
+    uint shift = 32 - sample.log2length;
+
+    u32 i0 = phase >> shift;
+    u32 i1 = (i0 + 1) & mask;
+
+    int s0 = Osc_sample_value(sample, i0);
+    int s1 = Osc_sample_value(sample, i1);
+
+    uint frac = (phase >> (shift - 16)) & 65535;
+    return ix16(s1 * (i32)frac + s0 * (i32)(65536 - frac));
+}
+
+template <> ForceInline int Osc_interpolate<Quality::High>(const Sample &sample, u32 phase)
+{
+    // Catmull-Rom interpolation
+    uint mask = (1 << sample.log2length) - 1;
+    uint shift = 32 - sample.log2length;
+
+    u32 i1 = phase >> shift;
+
+    f32 y0 = Osc_sample_value(sample, (i1 - 1) & mask);
+    f32 y1 = Osc_sample_value(sample, i1);
+    f32 y2 = Osc_sample_value(sample, (i1 + 1) & mask);
+    f32 y3 = Osc_sample_value(sample, (i1 + 2) & mask);
+
+    f32 mu = ((phase >> (shift - 16)) & 65535) * (1.0f / 65536);
+    f32 x = itp_catmull(y0, y1, y2, y3, mu);
+    // rounded as lrintf would, but not a call, the magnitude is under 2^22
+    x = (x + 12582912.0f) - 12582912.0f;
+    return clamp<int>((int)x, -32767, 32767);
+}
 
 ///
-struct OscConstant {
-    u32 osc_phi[128 * osc_phi_oversample];
-    explicit OscConstant(f64 fs);
-};
-static std::map<f64, std::unique_ptr<OscConstant>> Osc_const;
-static std::mutex Osc_const_mutex;
+// frames without sync input, each phase in closed form from the phase before
+//  them, so that the vector lanes are independent; a wrap is a phase decrease
+template <Quality Q>
+static void Osc_run(const Sample &sample, u32 phase, u32 phaseinc,
+                    i16 *outp, i8 *syncoutp, uint n)
+{
+    // the fields in registers, not loaded by lane
+    const u8 *data = sample.data;
+    uint log2length = sample.log2length;
+
+#pragma omp simd
+    for (uint i = 0; i < n; ++i) {
+        u32 oldphase = phase + i * phaseinc;
+        u32 newphase = oldphase + phaseinc;
+        syncoutp[i] = newphase < oldphase;
+        outp[i] = Osc_interpolate<Q>(Sample{data, log2length}, newphase);
+    }
+}
+
+template <Quality Q>
+static u32 Osc_generate(const Sample &sample, u32 phase, u32 phaseinc,
+                        i16 *outp, const i8 *syncinp, i8 *syncoutp, uint n)
+{
+    for (uint i = 0; i < n;) {
+        uint run = 0;
+        while (i + run < n && syncinp[i + run] <= 0)
+            ++run;
+        Osc_run<Q>(sample, phase, phaseinc, &outp[i], &syncoutp[i], run);
+        phase += run * phaseinc;
+        i += run;
+
+        if (i < n) {
+            // aliased sync, a frame on its own
+            phase = 0;
+            syncoutp[i] = 1;
+            outp[i] = Osc_interpolate<Q>(sample, phase);
+            ++i;
+        }
+    }
+    return phase;
+}
 
 ///
 Osc::Osc()
@@ -32,10 +132,7 @@ void Osc::initialize(f64 fs, uint bs)
 {
     (void)bs;
 
-    std::lock_guard<std::mutex> lock(Osc_const_mutex);
-    std::unique_ptr<OscConstant> &constant = Osc_const[fs];
-    if (!constant) constant.reset(new OscConstant(fs));
-    osc_phi_ = constant->osc_phi;
+    osc_phi_ = rate_tables(fs).osc_phi;
 }
 
 void Osc::setphase0(u32 phase0)
@@ -50,6 +147,11 @@ void Osc::setparam(const Param *p)
     param_ = p;
 }
 
+void Osc::set_quality(Quality q)
+{
+    quality_ = q;
+}
+
 void Osc::reset()
 {
     phase_ = phase0_;
@@ -62,10 +164,8 @@ void Osc::generate(i16 *outp, const i8 *syncinp, i8 *syncoutp,
 
     uint waveform = P.WAVEFORM;
 
-    const i8 *mod1 = modps[0];
-    const i8 *mod2 = modps[1];
-    i8 modamt1 = clamp<i8>(modamts[0], -63, +63);
-    i8 modamt2 = clamp<i8>(modamts[1], -63, +63);
+    (void)modps;
+    (void)modamts;
 
     Waveset waveset = waveset_by_id(waveform);
     u8 wavenum = waveset.wavenum[16 * key / 128];
@@ -74,62 +174,27 @@ void Osc::generate(i16 *outp, const i8 *syncinp, i8 *syncoutp,
     Sample sample = wave_sample(wave);
     // bool oneshot = wave_oneshot(wavenum);
 
-    u32 phase = phase_;
-    const u32 *osc_phi = osc_phi_;
-
-    for (uint i = 0; i < n; ++i) {
-        int mod = mod1[i] * modamt1 + mod2[i] * modamt2;  // -7938..+7938
-        mod = mod * 127 / 7938;  // -127..127
-
-        uint pitch = key * osc_phi_oversample;
+    uint pitch = key * osc_phi_oversample;
 #pragma message("TODO OSC semi/fine (wave)")
 #pragma message("TODO OSC semi/fine (program)")
 #pragma message("TODO OSC pitch mods")
+    // the mods will make it constant by control segment, not by block
+    u32 phaseinc = osc_phi_[clamp<uint>(pitch, 0, osc_phi_tablen - 1)];
 
-        u32 phaseinc = osc_phi[clamp<uint>(pitch, 0, osc_phi_tablen - 1)];
-
-        bool syncd = syncinp[i] > 0;
-        u32 oldphase = phase;
-        phase = syncd ? 0 : (phase + phaseinc);  // aliased sync
-        bool wrapd = syncd | (phase < oldphase);
-        syncoutp[i] = wrapd;
-
-        int out;
-        if (false) {  // no interpolation
-            uint index = phase >> (32 - sample.log2length);
-            out = (int)sample.data[index] * 65534 / 255 - 32767;
-        }
-        else {  // linear interpolation
-            uint length = 1 << sample.log2length;
-            uint shift = 32 - sample.log2length;
-
-            u32 i0 = phase >> shift;
-            u32 i1 = (i0 < length - 1) ? (i0 + 1) : 0;
-
-            int s0 = (int)sample.data[i0] * 65534 / 255 - 32767;
-            int s1 = (int)sample.data[i1] * 65534 / 255 - 32767;
-
-            uint frac = (phase >> (shift - 16)) & 65535;
-            out = ix16(s1 * (i32)frac + s0 * (i32)(65536 - frac));
-        }
-
-        syncoutp[i] = wrapd;
-        outp[i] = out;
-    }
-
-    phase_ = phase;
+    phase_ = generate_wave(quality_, sample, phase_, phaseinc, outp, syncinp, syncoutp, n);
 }
 
-OscConstant::OscConstant(f64 fs)
+u32 Osc::generate_wave(Quality q, const Sample &sample, u32 phase, u32 phaseinc,
+                       i16 *outp, const i8 *syncinp, i8 *syncoutp, uint n)
 {
-    for (uint i = 0; i < 128; ++i) {
-        for (uint j = 0, o = osc_phi_oversample; j < o; ++j) {
-            uint idx = j + i * o;
-            f64 key = i + (f64)j / o;
-            f64 freq = 440 * exp2((key - 69) / 12);
-            f64 rate = freq / fs;
-            osc_phi[idx] = (u32)(rate * UINT32_MAX);
-        }
+    switch (q) {
+    case Quality::Eco:
+        return Osc_generate<Quality::Eco>(sample, phase, phaseinc, outp, syncinp, syncoutp, n);
+    default:
+    case Quality::Normal:
+        return Osc_generate<Quality::Normal>(sample, phase, phaseinc, outp, syncinp, syncoutp, n);
+    case Quality::High:
+        return Osc_generate<Quality::High>(sample, phase, phaseinc, outp, syncinp, syncoutp, n);
     }
 }
 
@@ -14,20 +14,28 @@ public:
     void initialize(f64 fs, uint bs);
     void setparam(const Param *p);
     void setphase0(u32 phase0);
+    void set_quality(Quality q);
     void reset();
     void generate(i16 *outp, const i8 *syncinp, i8 *syncoutp,
                   const i8 *modps[2], const i8 modamts[2], uint key, uint n);
     // range -63..+63
 
+    // one wave at a constant increment, scalar only at the frames of sync
+    //  input, returns the phase after
+    static u32 generate_wave(Quality q, const Sample &sample, u32 phase, u32 phaseinc,
+                             i16 *outp, const i8 *syncinp, i8 *syncoutp, uint n);
+
 private:
-    // parameters
-    const Param *param_ = nullptr;
     // phase
     u32 phase_ = 0;
-    // phase increments normalized to fs
-    u32 *osc_phi_ = nullptr;
     // initial phase
     u32 phase0_ = 0;
+    // quality setting, selects the interpolator
+    Quality quality_ = Quality::Normal;
+    // parameters
+    const Param *param_ = nullptr;
+    // phase increments normalized to fs
+    const u32 *osc_phi_ = nullptr;
 };
 
 }  // namespace cws80
@@ -0,0 +1,116 @@
+#include "cws/component/rate_tables.h"
+#include "cws/component/tables.h"
+#include "utility/arithmetic.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+namespace cws80 {
+
+///
+struct RateSlot {
+    // bits of the sample rate, 0 if the slot is free
+    std::atomic<u64> key{0};
+    // tables, built once and never released
+    std::once_flag once;
+    std::atomic<const RateTables *> tables{nullptr};
+};
+
+// rates of a process, in the order of their first use
+static RateSlot Rate_slots[32];
+// rates past the slots, which a host would not normally use
+static std::map<f64, std::unique_ptr<const RateTables>> Rate_overflow;
+static std::mutex Rate_overflow_mutex;
+
+///
+RateTables::RateTables(f64 fs)
+    : fs(fs)
+{
+    scoped_fesetround(FE_TONEAREST);
+
+    for (uint i = 0; i < 64; ++i)
+        env_times[i] = lrint(Env_times[i] * fs);
+
+    for (uint i = 0; i < 64; ++i)
+        lfo_phi[i] = fx8(256 * Lfo_freqs[i] / fs);
+
+    for (uint i = 0; i < 128; ++i) {
+        for (uint j = 0, o = osc_phi_oversample; j < o; ++j) {
+            uint idx = j + i * o;
+            f64 key = i + (f64)j / o;
+            f64 freq = 440 * exp2((key - 69) / 12);
+            f64 rate = freq / fs;
+            osc_phi[idx] = (u32)(rate * UINT32_MAX);
+        }
+    }
+}
+
+const RateTables &rate_tables(f64 fs)
+{
+    u64 key;
+    memcpy(&key, &fs, sizeof(key));
+    assert(fs > 0);
+
+    for (RateSlot &slot : Rate_slots) {
+        u64 k = slot.key.load(std::memory_order_acquire);
+        if (k == 0 && slot.key.compare_exchange_strong(k, key, std::memory_order_acq_rel))
+            k = key;
+        if (k != key)
+            continue;
+        const RateTables *tables = slot.tables.load(std::memory_order_acquire);
+        if (!tables) {
+            // the other callers of this rate wait until it is built
+            std::call_once(slot.once, [&slot, fs]() {
+                slot.tables.store(new RateTables(fs), std::memory_order_release);
+            });
+            tables = slot.tables.load(std::memory_order_acquire);
+        }
+        return *tables;
+    }
+
+    std::lock_guard<std::mutex> lock(Rate_overflow_mutex);
+    std::unique_ptr<const RateTables> &tables = Rate_overflow[fs];
+    if (!tables) tables.reset(new RateTables(fs));
+    return *tables;
+}
+
+///
+struct RatePrebuild {
+    RatePrebuild();
+    ~RatePrebuild();
+    std::thread thread;
+};
+
+RatePrebuild::RatePrebuild()
+{
+    try {
+        thread = std::thread([]() {
+            for (f64 fs : {44100.0, 48000.0, 88200.0, 96000.0})
+                rate_tables(fs);
+        });
+    }
+    catch (std::system_error &) {
+        // no thread, the tables get built on their first use
+    }
+}
+
+RatePrebuild::~RatePrebuild()
+{
+    // finish before the code may be unloaded
+    if (thread.joinable())
+        thread.join();
+}
+
+void prebuild_rate_tables()
+{
+    static RatePrebuild prebuild;
+    (void)prebuild;
+}
+
+}  // namespace cws80
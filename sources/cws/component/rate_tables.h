@@ -0,0 +1,32 @@
+#pragma once
+#include "utility/types.h"
+
+namespace cws80 {
+
+// resolution of the oscillator pitch, per interval of a semitone
+static constexpr uint osc_phi_oversample = 8;
+static constexpr uint osc_phi_tablen = 128 * osc_phi_oversample;
+
+//------------------------------------------------------------------------------
+// tables which depend on the sample rate, shared by all instruments
+struct RateTables {
+    explicit RateTables(f64 fs);
+    // sample rate
+    f64 fs = 0;
+    // durations of the T1-T4 parameters (frames)
+    u32 env_times[64];
+    // Q8,24 phase increments of the LFO frequencies
+    u32 lfo_phi[64];
+    // oscillator phase increments normalized to fs
+    u32 osc_phi[osc_phi_tablen];
+};
+
+// the tables of a sample rate, built once by the first caller
+//  when they exist, the lookup takes no lock and does not allocate
+const RateTables &rate_tables(f64 fs);
+
+// build the tables of the common sample rates on a background thread,
+//  the first time it is called
+void prebuild_rate_tables();
+
+}  // namespace cws80
@@ -1,15 +1,16 @@
 #include "cws/component/sat.h"
 #include "cws/component/tables.h"
 #include "utility/arithmetic.h"
-#include <memory>
-#include <mutex>
 #include <math.h>
 
 namespace cws80 {
 
 enum {
     Sat_tablen = 32768,
+    // the oversampling ratio which the saturator input level is designed for
     Sat_oversample = 4,
+    // the maximum length of the antialias filters
+    Sat_maxtaps = 128,
 };
 
 ///
@@ -17,26 +18,90 @@ struct SatConstant {
     i16 sat_table[Sat_tablen];
     SatConstant();
 };
-static std::unique_ptr<SatConstant> Sat_const;
-static std::mutex Sat_const_mutex;
+
+// the table of the process, built by the first caller
+static const SatConstant &Sat_constant()
+{
+    static const SatConstant constant;
+    return constant;
+}
 
 ///
-void Sat::initialize(f64 fs, uint bs)
+#ifdef CWS_FIXED_POINT_FIR_FILTERS
+typedef fir32l<i32> Sat_upfilter;
+typedef fir32l<i16> Sat_downfilter;
+typedef i32 Sat_upsample;
+typedef i16 Sat_downsample;
+#else
+typedef realfir<f32> Sat_upfilter;
+typedef realfir<f32> Sat_downfilter;
+typedef f32 Sat_upsample;
+typedef f32 Sat_downsample;
+#endif
+
+size_t Sat::memory_size(uint bs)
+{
+    (void)bs;
+    return arena::footprint(2 * Sat_maxtaps * sizeof(Sat_upsample)) +
+           arena::footprint(2 * Sat_maxtaps * sizeof(Sat_downsample));
+}
+
+void Sat::initialize(f64 fs, uint bs, arena &mem)
 {
     (void)fs;
     (void)bs;
 
+    aaflt1_ = Sat_upfilter(mem.allocate_array<Sat_upsample>(2 * Sat_maxtaps), Sat_maxtaps);
+    aaflt2_ = Sat_downfilter(mem.allocate_array<Sat_downsample>(2 * Sat_maxtaps), Sat_maxtaps);
+    set_quality(quality_);
+
+    sat_table_ = Sat_constant().sat_table;
+}
+
+memory_region Sat::shared_table()
+{
+    const SatConstant &constant = Sat_constant();
+    return memory_region{constant.sat_table, sizeof(constant.sat_table)};
+}
+
+void Sat::set_quality(Quality q)
+{
+    uint taps;
+
+    switch (q) {
+    case Quality::Eco:
+        over_ = 2;
+        taps = Sat_aa2x.size();
 #ifdef CWS_FIXED_POINT_FIR_FILTERS
-    aaflt1_ = fir32l<i32>(Sat_aa4x.size());
-    aaflt2_ = fir32l<i16>(Sat_aa4x.size());
+        aacoef_ = Sat_aa2x.data();
 #else
-    aaflt1_ = realfir<f32>(Sat_aa4x.size());
-    aaflt2_ = realfir<f32>(Sat_aa4x.size());
+        aacoef_ = Sat_aa2x_real.data();
 #endif
+        break;
+    default:
+    case Quality::Normal:
+        over_ = 4;
+        taps = Sat_aa4x.size();
+#ifdef CWS_FIXED_POINT_FIR_FILTERS
+        aacoef_ = Sat_aa4x.data();
+#else
+        aacoef_ = Sat_aa4x_real.data();
+#endif
+        break;
+    case Quality::High:
+        over_ = 4;
+        taps = Sat_aa4x_hq.size();
+#ifdef CWS_FIXED_POINT_FIR_FILTERS
+        aacoef_ = Sat_aa4x_hq.data();
+#else
+        aacoef_ = Sat_aa4x_hq_real.data();
+#endif
+        break;
+    }
 
-    std::lock_guard<std::mutex> lock(Sat_const_mutex);
-    if (!Sat_const) Sat_const.reset(new SatConstant);
-    sat_table_ = Sat_const->sat_table;
+    quality_ = q;
+    aaflt1_.resize(taps);
+    aaflt2_.resize(taps);
 }
 
 void Sat::generate(const i32 *inp, i16 *outp, uint n)
@@ -47,27 +112,43 @@ void Sat::generate(const i32 *inp, i16 *outp, uint n)
         return;
     }
 
+    switch (over_) {
+    case 2:
+        generate_over<2>(inp, outp, n);
+        break;
+    default:
+        generate_over<4>(inp, outp, n);
+        break;
+    }
+}
+
+template <uint Over> void Sat::generate_over(const i32 *inp, i16 *outp, uint n)
+{
     const i16 *sat_table = sat_table_;
 
 #ifdef CWS_FIXED_POINT_FIR_FILTERS
+    const i32 *aacoef = aacoef_;
     fir32l<i32> &aaflt1 = aaflt1_;
     fir32l<i16> &aaflt2 = aaflt2_;
 #else
+    const f32 *aacoef = aacoef_;
     realfir<f32> &aaflt1 = aaflt1_;
     realfir<f32> &aaflt2 = aaflt2_;
 #endif
 
     for (uint i = 0; i < n; ++i) {
-        i32 in = inp[i];  // -98301..+98301
+        // -98301..+98301, scaled so that the upsampler has the gain of the
+        //  reference ratio whatever the oversampling
+        i32 in = inp[i] * (i32)Over / Sat_oversample;
 
-        i32 satout[Sat_oversample];
-        for (uint o = 0; o < Sat_oversample; ++o) {
+        i32 satout = 0;
+        for (uint o = 0; o < Over; ++o) {
 #ifdef CWS_FIXED_POINT_FIR_FILTERS
             aaflt1.in((o == 0) ? in : 0);
-            i32 satin = aaflt1.out(Sat_aa4x.data());
+            i32 satin = aaflt1.out(aacoef);
 #else
             aaflt1.in((o == 0) ? (f32)in : 0);
-            i32 satin = (i32)lrint(aaflt1.out(Sat_aa4x_real.data()));
+            i32 satin = (i32)lrint(aaflt1.out(aacoef));
 #endif
 
             u1 sign = satin < 0;
@@ -76,14 +157,17 @@ void Sat::generate(const i32 *inp, i16 *outp, uint n)
             i16 out = sign ? -absout : absout;
 
             aaflt2.in(out);
+            // decimation: only the first phase is kept
+            if (o == 0) {
 #ifdef CWS_FIXED_POINT_FIR_FILTERS
-            satout[o] = aaflt2.out(Sat_aa4x.data());
+                satout = aaflt2.out(aacoef);
 #else
-            satout[o] = (i32)aaflt2.out(Sat_aa4x_real.data());
+                satout = (i32)aaflt2.out(aacoef);
 #endif
+            }
         }
 
-        outp[i] = satout[0];
+        outp[i] = satout;
     }
 }
 
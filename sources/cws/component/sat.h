@@ -1,5 +1,8 @@
 #pragma once
+#include "cws/cws80_data.h"
+#include "utility/arena.h"
 #include "utility/filter.h"
+#include "utility/resident.h"
 #include "utility/types.h"
 #include <memory>
 
@@ -7,24 +10,40 @@ namespace cws80 {
 
 class Sat {
 public:
-    void initialize(f64 fs, uint bs);
+    // memory to take from the arena at initialization
+    static size_t memory_size(uint bs);
+    void initialize(f64 fs, uint bs, arena &mem);
+    // the saturation table which all the saturators read
+    static memory_region shared_table();
+    void set_quality(Quality q);
     void reset() {}
     void generate(const i32 *inp, i16 *outp, uint n);
 
 private:
-    // saturation function
-    i16 *sat_table_ = nullptr;
+    template <uint Over> void generate_over(const i32 *inp, i16 *outp, uint n);
+
+private:
 #ifdef CWS_FIXED_POINT_FIR_FILTERS
     // upsampling antialias filter
     fir32l<i32> aaflt1_;
     // downsampling antialias filter
     fir32l<i16> aaflt2_;
+    // antialias filter coefficients
+    const i32 *aacoef_ = nullptr;
 #else
     // upsampling antialias filter
     realfir<f32> aaflt1_;
     // downsampling antialias filter
     realfir<f32> aaflt2_;
+    // antialias filter coefficients
+    const f32 *aacoef_ = nullptr;
 #endif
+    // oversampling ratio
+    uint over_ = 0;
+    // quality setting
+    Quality quality_ = Quality::Normal;
+    // saturation function
+    const i16 *sat_table_ = nullptr;
 };
 
 }  // namespace cws80
@@ -165,6 +165,75 @@ const std::array<f32, 64> Sat_aa4x_real{
      -1.094623e-03, 6.114373e-04,  1.420512e-03,  1.258360e-03,  5.888653e-04,
      -4.210023e-05, -3.393664e-04, -3.180840e-04, -1.732080e-04}};
 
+const std::array<i32, 32> Sat_aa2x{
+    {-369930, -1274966, 2978288, 5848122, -10338493, -17000301,
+     26504180, 39689693, -57669947, -82054570, 115442333, 162599602,
+     -233686931, -355249839, 625169477, 1926896921, 1926896921, 625169477,
+     -355249839, -233686931, 162599602, 115442333, -82054570, -57669947,
+     39689693, 26504180, -17000301, -10338493, 5848122, 2978288,
+     -1274966, -369930}};
+
+const std::array<f32, 32> Sat_aa2x_real{
+    {-8.613097e-05, -2.968510e-04, 6.934369e-04, 1.361622e-03, -2.407118e-03,
+     -3.958191e-03, 6.170986e-03, 9.240977e-03, -1.342733e-02, -1.910482e-02,
+     2.687851e-02, 3.785817e-02, -5.440948e-02, -8.271305e-02, 1.455586e-01,
+     4.486407e-01, 4.486407e-01, 1.455586e-01, -8.271305e-02, -5.440948e-02,
+     3.785817e-02, 2.687851e-02, -1.910482e-02, -1.342733e-02, 9.240977e-03,
+     6.170986e-03, -3.958191e-03, -2.407118e-03, 1.361622e-03, 6.934369e-04,
+     -2.968510e-04, -8.613097e-05}};
+
+const std::array<i32, 128> Sat_aa4x_hq{
+    {-19271, -74022, -108890, -63082, 85122, 269905,
+     347000, 181594, -226108, -671256, -816561, -407552,
+     486944, 1393979, 1641640, 795812, -926054, -2587926,
+     -2981129, -1416044, 1617064, 4440747, 5032952, 2354664,
+     -2651058, -7184224, -8041556, -3718567, 4141040, 11107341,
+     12313800, 5643122, -6231697, -16584965, -18253867, -8309785,
+     9120828, 24140930, 26440264, 11985096, -13107173, -34589988,
+     -37801046, -17110694, 18702627, 49377842, 54043695, 24530322,
+     -26924469, -71499068, -78864264, -36158843, 40203276, 108526617,
+     122223571, 57544695, -66199982, -186833425, -223285524, -114097469,
+     147791641, 502312154, 840301040, 1046131850, 1046131850, 840301040,
+     502312154, 147791641, -114097469, -223285524, -186833425, -66199982,
+     57544695, 122223571, 108526617, 40203276, -36158843, -78864264,
+     -71499068, -26924469, 24530322, 54043695, 49377842, 18702627,
+     -17110694, -37801046, -34589988, -13107173, 11985096, 26440264,
+     24140930, 9120828, -8309785, -18253867, -16584965, -6231697,
+     5643122, 12313800, 11107341, 4141040, -3718567, -8041556,
+     -7184224, -2651058, 2354664, 5032952, 4440747, 1617064,
+     -1416044, -2981129, -2587926, -926054, 795812, 1641640,
+     1393979, 486944, -407552, -816561, -671256, -226108,
+     181594, 347000, 269905, 85122, -63082, -108890,
+     -74022, -19271}};
+
+const std::array<f32, 128> Sat_aa4x_hq_real{
+    {-4.486651e-06, -1.723438e-05, -2.535281e-05, -1.468733e-05, 1.981903e-05,
+     6.284229e-05, 8.079246e-05, 4.228083e-05, -5.264464e-05, -1.562888e-04,
+     -1.901203e-04, -9.489045e-05, 1.133756e-04, 3.245613e-04, 3.822242e-04,
+     1.852897e-04, -2.156136e-04, -6.025484e-04, -6.940981e-04, -3.296982e-04,
+     3.765021e-04, 1.033942e-03, 1.171826e-03, 5.482380e-04, -6.172475e-04,
+     -1.672707e-03, -1.872321e-03, -8.657963e-04, 9.641611e-04, 2.586129e-03,
+     2.867030e-03, 1.313892e-03, -1.450930e-03, -3.861488e-03, -4.250060e-03,
+     -1.934773e-03, 2.123608e-03, 5.620748e-03, 6.156104e-03, 2.790498e-03,
+     -3.051751e-03, -8.053609e-03, -8.801242e-03, -3.983894e-03, 4.354545e-03,
+     1.149667e-02, 1.258303e-02, 5.711411e-03, -6.268841e-03, -1.664717e-02,
+     -1.836202e-02, -8.418887e-03, 9.360555e-03, 2.526832e-02, 2.845739e-02,
+     1.339817e-02, -1.541338e-02, -4.350055e-02, -5.198771e-02, -2.656539e-02,
+     3.441042e-02, 1.169537e-01, 1.956478e-01, 2.435716e-01, 2.435716e-01,
+     1.956478e-01, 1.169537e-01, 3.441042e-02, -2.656539e-02, -5.198771e-02,
+     -4.350055e-02, -1.541338e-02, 1.339817e-02, 2.845739e-02, 2.526832e-02,
+     9.360555e-03, -8.418887e-03, -1.836202e-02, -1.664717e-02, -6.268841e-03,
+     5.711411e-03, 1.258303e-02, 1.149667e-02, 4.354545e-03, -3.983894e-03,
+     -8.801242e-03, -8.053609e-03, -3.051751e-03, 2.790498e-03, 6.156104e-03,
+     5.620748e-03, 2.123608e-03, -1.934773e-03, -4.250060e-03, -3.861488e-03,
+     -1.450930e-03, 1.313892e-03, 2.867030e-03, 2.586129e-03, 9.641611e-04,
+     -8.657963e-04, -1.872321e-03, -1.672707e-03, -6.172475e-04, 5.482380e-04,
+     1.171826e-03, 1.033942e-03, 3.765021e-04, -3.296982e-04, -6.940981e-04,
+     -6.025484e-04, -2.156136e-04, 1.852897e-04, 3.822242e-04, 3.245613e-04,
+     1.133756e-04, -9.489045e-05, -1.901203e-04, -1.562888e-04, -5.264464e-05,
+     4.228083e-05, 8.079246e-05, 6.284229e-05, 1.981903e-05, -1.468733e-05,
+     -2.535281e-05, -1.723438e-05, -4.486651e-06}};
+
 const std::array<f32, 128> Vcf_freqs{
     {48.87,   51.7841, 54.872,  58.1441, 61.6112, 65.2851, 69.1781, 73.3032,
      77.6742, 82.306,  87.2139, 92.4145, 97.9252, 103.764, 109.952, 116.508,
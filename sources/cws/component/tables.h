@@ -31,6 +31,26 @@ extern const std::array<i32, 64> Sat_aa4x;
 // normalized for sum < 1
 extern const std::array<f32, 64> Sat_aa4x_real;
 
+// antialias 2X filter Q32,32
+//  kaiser-windowed sinc, 32 taps, fc = 0.25, beta = 7
+//  floor((b / sum(b)) * 2^32)
+extern const std::array<i32, 32> Sat_aa2x;
+
+// antialias 2X filter F32
+//  kaiser-windowed sinc, 32 taps, fc = 0.25, beta = 7
+// normalized for sum = 1
+extern const std::array<f32, 32> Sat_aa2x_real;
+
+// antialias 4X filter Q32,32 (high quality)
+//  kaiser-windowed sinc, 128 taps, fc = 0.125, beta = 8
+//  floor((b / sum(b)) * 2^32)
+extern const std::array<i32, 128> Sat_aa4x_hq;
+
+// antialias 4X filter F32 (high quality)
+//  kaiser-windowed sinc, 128 taps, fc = 0.125, beta = 8
+// normalized for sum = 1
+extern const std::array<f32, 128> Sat_aa4x_hq_real;
+
 // VCF frequency table (approx from spectral analysis)
 //    a*exp(b*x) with a=48.87, b=0.05792
 extern const std::array<f32, 128> Vcf_freqs;
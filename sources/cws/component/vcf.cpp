@@ -1,10 +1,7 @@
 #include "cws/component/vcf.h"
 #include "cws/component/tables.h"
-#if 1
-#else
-#include "dsp/biquad-design.h"
-#endif
 #include "utility/arithmetic.h"
+#include <new>
 
 #pragma message("TODO implement VCF")
 
@@ -32,12 +29,61 @@ void Vcf::setparam(const Param *p)
     param_ = p;
 }
 
+void Vcf::set_quality(Quality q)
+{
+    if (q == quality_)
+        return;
+
+    quality_ = q;
+
+    Ladder &ladder = ladder_;
+    switch (q) {
+    case Quality::Eco:
+        new (&ladder.eco) dsp::lpcfmoog::eco_filter();
+        break;
+    default:
+    case Quality::Normal:
+        new (&ladder.fast) dsp::lpcfmoog::fast_filter();
+        break;
+    case Quality::High:
+        new (&ladder.nice) dsp::lpcfmoog::nice_filter();
+        break;
+    }
+
+    // compute coefficients of the new filter on the next sample
+    refresh();
+}
+
+void Vcf::refresh()
+{
+    cycle_ = update_cycle_ - 1;
+}
+
 void Vcf::reset()
 {
 }
 
 void Vcf::generate(i16 *outp, const i16 *inp, const i8 *modps[2],
                    const i8 modamts[2], uint key, uint n)
+{
+    Ladder &ladder = ladder_;
+    switch (quality_) {
+    case Quality::Eco:
+        generate_with(ladder.eco, outp, inp, modps, modamts, key, n);
+        break;
+    default:
+    case Quality::Normal:
+        generate_with(ladder.fast, outp, inp, modps, modamts, key, n);
+        break;
+    case Quality::High:
+        generate_with(ladder.nice, outp, inp, modps, modamts, key, n);
+        break;
+    }
+}
+
+template <class Filter>
+void Vcf::generate_with(Filter &filter, i16 *outp, const i16 *inp,
+                        const i8 *modps[2], const i8 modamts[2], uint key, uint n)
 {
     const Param &P = *param_;
     f64 fs = fs_;
@@ -59,12 +105,6 @@ void Vcf::generate(i16 *outp, const i16 *inp, const i8 *modps[2],
     uint cycle = cycle_;
     const uint update_cycle = update_cycle_;
 
-#if 1
-    dsp::lpcfmoog::fast_filter &filter = filter_;
-#else
-    dsp::biquad<f64>(&filter)[2] = filter_;
-#endif
-
     for (uint i = 0; i < n; ++i) {
         int mod = mod1[i] * modamt1 + mod2[i] * modamt2;  // -7938..+7938
         mod = mod * 127 / 7938;  // -127..127
@@ -75,26 +115,16 @@ void Vcf::generate(i16 *outp, const i16 *inp, const i8 *modps[2],
         fc = clamp(fc, 0.0, 0.5);
 
         // TODO SQ80 filter
-#if 1
         const f64 scale = 32767;
         f64 out = scale * filter.tick(inp[i] * (1.0 / scale));
-#else
-        f64 out = filter[1].tick(filter[0].tick(inp[i]));
-#endif
         // hard clip
         outp[i] = (i16)clamp<long>(lrint(out), -32768, 32767);
 
         if (++cycle == update_cycle) {
-#if 1
+            cycle = 0;
             const f64 qmin = 0.2;
             const f64 qmax = 0.8;
             filter.lp(fc, q * (qmax - qmin) + qmin);  // Q range?
-#else
-            dsp::biquad_design dsn;
-            dsn.lp(fc, sqrt(8.0 * (q + 1.0)));  // Q range?
-            dsn.apply_to(filter[0]);
-            dsn.apply_to(filter[1]);
-#endif
         }
     }
 
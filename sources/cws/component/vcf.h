@@ -1,11 +1,7 @@
 #pragma once
 #include "cws/cws80_program.h"
 #include "cws/cws80_data.h"
-#if 1
 #include "dsp/lpcfmoog.h"
-#else
-#include "dsp/biquad-exec.h"
-#endif
 #include "utility/types.h"
 
 namespace cws80 {
@@ -17,27 +13,39 @@ public:
     Vcf();
     void initialize(f64 fs, uint bs);
     void setparam(const Param *p);
+    void set_quality(Quality q);
+    // update the coefficients at the next sample
+    void refresh();
     void reset();
     void generate(i16 *outp, const i16 *inp, const i8 *modps[2],
                   const i8 modamts[2], uint key, uint n);  // range -63..+63
 
 private:
-    // parameters
-    const Param *param_ = nullptr;
-    // sample rate
-    f64 fs_ = 44100;
+    template <class Filter>
+    void generate_with(Filter &filter, i16 *outp, const i16 *inp,
+                       const i8 *modps[2], const i8 modamts[2], uint key, uint n);
+
+private:
+    // ladder filter of the quality, a new one at each change
+    union Ladder {
+        Ladder() : fast() {}
+        dsp::lpcfmoog::eco_filter eco;
+        dsp::lpcfmoog::fast_filter fast;
+        dsp::lpcfmoog::nice_filter nice;
+    };
+    Ladder ladder_;
 
     // cycle number
     uint cycle_ = 0;
     // update cycle number
     uint update_cycle_ = 0;
+    // quality setting
+    Quality quality_ = Quality::Normal;
 
-#if 1
-    dsp::lpcfmoog::fast_filter filter_;
-#else
-    // biquad filter cascade
-    dsp::biquad<f64> filter_[2];
-#endif
+    // parameters
+    const Param *param_ = nullptr;
+    // sample rate
+    f64 fs_ = 44100;
 };
 
 }  // namespace cws80
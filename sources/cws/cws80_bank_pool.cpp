@@ -0,0 +1,71 @@
+#include "cws/cws80_bank_pool.h"
+#include "utility/arithmetic.h"
+#include <assert.h>
+
+namespace cws80 {
+
+BankPool::BankPool(Storage *storage)
+{
+    if (!storage) {
+        // not initialized, so the memory is committed only when used
+        storage = new Storage;
+        own_storage_.reset(storage);
+    }
+    storage_ = storage;
+}
+
+static Bank *Pool_acquire(BankPool::Storage &st, uint reserved)
+{
+    // reclaim what the audio thread has retired since
+    u32 retired = st.retired.exchange(0, std::memory_order_acquire);
+    if (retired)
+        st.free.fetch_or(retired, std::memory_order_relaxed);
+
+    u32 mask = st.free.load(std::memory_order_relaxed);
+    while (popcount(mask) > reserved) {
+        uint index = ctz((u64)mask);
+        if (st.free.compare_exchange_weak(mask, mask & ~(1u << index), std::memory_order_acquire))
+            return &st.banks[index];
+    }
+    return nullptr;
+}
+
+Bank *BankPool::acquire()
+{
+    Storage &st = *storage_;
+    return Pool_acquire(st, st.reserved.load(std::memory_order_relaxed));
+}
+
+Bank *BankPool::acquire_reserved()
+{
+    return Pool_acquire(*storage_, 0);
+}
+
+void BankPool::reserve(uint count)
+{
+    storage_->reserved.store(count, std::memory_order_relaxed);
+}
+
+void BankPool::release(Bank *bank)
+{
+    storage_->free.fetch_or(1u << index_of(bank), std::memory_order_release);
+}
+
+void BankPool::retire(Bank *bank)
+{
+    storage_->retired.fetch_or(1u << index_of(bank), std::memory_order_release);
+}
+
+Bank *BankPool::bank(uint index) const
+{
+    return (index < capacity) ? &storage_->banks[index] : nullptr;
+}
+
+uint BankPool::index_of(const Bank *bank) const
+{
+    uint index = bank - storage_->banks;
+    assert(index < capacity);
+    return index;
+}
+
+}  // namespace cws80
@@ -0,0 +1,57 @@
+#pragma once
+#include "cws/cws80_program.h"
+#include "utility/types.h"
+#include <atomic>
+#include <memory>
+
+namespace cws80 {
+
+//------------------------------------------------------------------------------
+// preallocated banks, which pass from the user interface to the audio thread
+//  by index. the user interface acquires a free bank and fills it, the
+//  audio thread installs it and retires the one it replaces. retired banks
+//  are reclaimed by the next thread which acquires. the audio thread also
+//  acquires, when it copies a shared bank to write it, and the user interface
+//  leaves it a bank for each of the instrument banks which it may copy.
+class BankPool {
+public:
+    // the banks the instrument may write, and spares for loading
+    enum { instrument_banks = 4, load_spares = 4 };
+    enum { capacity = instrument_banks + load_spares };
+
+    // memory of the pool, which can be shared between processes
+    struct Storage {
+        // banks which can be acquired
+        std::atomic<u32> free{(1u << capacity) - 1};
+        // banks which were retired, and not reclaimed yet
+        std::atomic<u32> retired{0};
+        // free banks which only the audio thread acquires
+        std::atomic<u32> reserved{instrument_banks};
+        Bank banks[capacity];
+    };
+
+    // a pool which uses the storage, or its own if none
+    explicit BankPool(Storage *storage = nullptr);
+
+    // take a free bank, past the reserved ones, or nullptr if none
+    //  (user interface)
+    Bank *acquire();
+    // take a free bank, the reserved ones included (audio thread)
+    Bank *acquire_reserved();
+    // set how many free banks the user interface leaves (audio thread)
+    void reserve(uint count);
+    // give back a bank which was acquired and not sent (user interface)
+    void release(Bank *bank);
+    // give back a bank which the audio thread no longer uses (audio thread)
+    void retire(Bank *bank);
+
+    // the bank at an index, or nullptr if invalid
+    Bank *bank(uint index) const;
+    uint index_of(const Bank *bank) const;
+
+private:
+    std::unique_ptr<Storage> own_storage_;
+    Storage *storage_ = nullptr;
+};
+
+}  // namespace cws80
@@ -61,6 +61,50 @@ const char *lfo_wave_name(LfoWave id)
     }
 }
 
+const char *quality_name(Quality id)
+{
+    switch (id) {
+    case Quality::Eco:
+        return "Eco";
+    case Quality::Normal:
+        return "Normal";
+    case Quality::High:
+        return "High";
+    default:
+        return "";
+    }
+}
+
+const char *engine_rate_name(EngineRate id)
+{
+    switch (id) {
+    case EngineRate::Host:
+        return "Host";
+    case EngineRate::Rate44100:
+        return "44.1 kHz";
+    case EngineRate::Rate48000:
+        return "48 kHz";
+    case EngineRate::Hardware:
+        return "Hardware";
+    default:
+        return "";
+    }
+}
+
+f64 engine_rate_value(EngineRate id, f64 host_fs)
+{
+    switch (id) {
+    case EngineRate::Rate44100:
+        return 44100;
+    case EngineRate::Rate48000:
+        return 48000;
+    case EngineRate::Hardware:
+        return hardware_sample_rate;
+    default:
+        return host_fs;
+    }
+}
+
 Waveset waveset_by_id(WavesetId id)
 {
     const u8 *rom = rom_data.prog;
@@ -55,6 +55,24 @@ enum class LfoWave : u8 {
     NOI,
 };
 
+// rendering quality, trading CPU cost for fidelity
+enum class Quality : u8 {
+    Eco,
+    Normal,
+    High,
+};
+
+// sample rate of the synthesis engine
+enum class EngineRate : u8 {
+    Host,
+    Rate44100,
+    Rate48000,
+    Hardware,
+};
+
+// sample rate of the original DOC 5503, clocked at 7 MHz with 32 oscillators
+constexpr f64 hardware_sample_rate = 7e6 / (8 * 34);
+
 typedef u8 WaveId;
 typedef u8 WavesetId;
 
@@ -65,6 +83,9 @@ enum {
 
 const char *modulator_name(Mod id);
 const char *lfo_wave_name(LfoWave id);
+const char *quality_name(Quality id);
+const char *engine_rate_name(EngineRate id);
+f64 engine_rate_value(EngineRate id, f64 host_fs);
 
 Waveset waveset_by_id(WavesetId id);
 Waveset *waveset_by_name(const char *name, Waveset *buf);
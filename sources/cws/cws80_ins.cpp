@@ -1,32 +1,136 @@
 #include "cws/cws80_ins.h"
 #include "cws/cws80_data.h"
 #include "cws/cws80_data_banks.h"
+#include "cws/component/rate_tables.h"
+#include "cws/component/tables.h"
 #include "utility/arithmetic.h"
-#include "utility/scope_guard.h"
+#include "utility/resident.h"
+#include <chrono>
 #include <algorithm>
-#include <mutex>
 #include <limits>
+#include <new>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 namespace cws80 {
 
-static uint Ins_vel2_table[127];
-static bool Ins_tables_init = false;
-static std::mutex Ins_tables_mutex;
+///
+struct InsVel2Table {
+    uint data[128];
+    constexpr uint operator[](uint i) const { return data[i]; }
+};
+static constexpr InsVel2Table Ins_generate_vel2()
+{
+    InsVel2Table table{};
+    for (uint i = 0; i < 128; ++i) {
+        // 63 * sin(acos((127 - i) / 127)), which is 63 * sqrt(d) / 127,
+        //  rounded to the nearest, which is never a tie
+        u64 d = i * (254 - i);
+        uint n = 0;
+        while (127 * 127 * (u64)(2 * n + 1) * (2 * n + 1) <= 4 * 63 * 63 * d)
+            ++n;
+        table.data[i] = n;
+    }
+    return table;
+}
+
+// computed by the compiler, for all velocities 0-127
+static constexpr InsVel2Table Ins_vel2_table = Ins_generate_vel2();
+
+///
+// working buffers of Voice::synthesize_adding
+enum InsBuffer {
+    Ins_oscout0, Ins_oscout1, Ins_oscout2,
+    Ins_dcaout0, Ins_dcaout1, Ins_dcaout2,
+    Ins_syncout, Ins_satin, Ins_satout, Ins_vcfout,
+    Ins_buffer_count,
+};
+
+// the steps of the rendering, in order
+//  0-5: osc 1, dca 1, osc 2, dca 2, osc 3, dca 3, 6: sum, 7: sat, 8: vcf, 9: dca4
+struct InsBufferUse {
+    // first and last step which use the buffer
+    uint first, last;
+    // size in rows of block size i16
+    uint units;
+};
+
+static constexpr InsBufferUse Ins_buffer_uses[Ins_buffer_count] = {
+    {0, 3, 1}, {2, 3, 1}, {4, 5, 1},
+    {1, 6, 1}, {3, 6, 1}, {5, 6, 1},
+    {0, 2, 1}, {6, 7, 2}, {7, 8, 1}, {8, 9, 1},
+};
+
+struct InsBufferPlan {
+    // placement of the buffers (rows)
+    uint offset[Ins_buffer_count];
+    // size of the scratch area (rows)
+    uint units;
+};
+
+static constexpr InsBufferPlan Ins_plan_buffers()
+{
+    // each buffer goes at the lowest place free during its whole life
+    InsBufferPlan plan{};
+    for (uint i = 0; i < Ins_buffer_count; ++i) {
+        const InsBufferUse &u = Ins_buffer_uses[i];
+        uint off = 0;
+        for (bool moved = true; moved;) {
+            moved = false;
+            for (uint j = 0; j < i; ++j) {
+                const InsBufferUse &v = Ins_buffer_uses[j];
+                bool live = u.first <= v.last && v.first <= u.last;
+                bool overlap = off < plan.offset[j] + v.units &&
+                               plan.offset[j] < off + u.units;
+                if (live && overlap) {
+                    off = plan.offset[j] + v.units;
+                    moved = true;
+                }
+            }
+        }
+        plan.offset[i] = off;
+        if (off + u.units > plan.units)
+            plan.units = off + u.units;
+    }
+    return plan;
+}
+
+// computed by the compiler, the buffers whose lives are apart share memory
+static constexpr InsBufferPlan Ins_buffer_plan = Ins_plan_buffers();
+
+static std::array<std::shared_ptr<const Bank>, 4> Ins_make_default_banks();
+
+// the banks after a reset, which all instruments share until they write
+static const std::array<std::shared_ptr<const Bank>, 4> &Ins_default_banks()
+{
+    static const std::array<std::shared_ptr<const Bank>, 4> banks = Ins_make_default_banks();
+    return banks;
+}
 
 //------------------------------------------------------------------------------
 Voice::~Voice()
 {
 }
 
-void Voice::initialize(f64 fs, uint bs, pb_alloc<> &alloc)
+size_t Voice::memory_size(uint bs)
 {
-    alloc_ = &alloc;
-    bs_ = bs;
+    return Sat::memory_size(bs);
+}
 
-    for (uint i = 0; i < 16; ++i)
-        mods_[i] = std::make_shared<mod_buffer>(bs);
+size_t Voice::scratch_size(uint bs)
+{
+    // a row of zeros, a row for discarded output, and the planned buffers
+    return (2 + Ins_buffer_plan.units) * arena::footprint(bs * sizeof(i16));
+}
+
+void Voice::initialize(f64 fs, uint bs, mod_matrix &mods, uint row,
+                       i16 *scratch, arena &mem)
+{
+    scratch_ = scratch;
+    bs_ = bs;
+    mods_ = &mods;
+    mod_row_ = row;
 
     for (uint i = 0; i < 4; ++i) {
         Env &env = env_[i];
@@ -37,6 +141,8 @@ void Voice::initialize(f64 fs, uint bs, pb_alloc<> &alloc)
         Lfo &lfo = lfo_[i];
         lfo.initialize(fs, bs);
         lfo.setparam(&pgm_.lfos[i]);
+        // the rows are distinct, so is the noise of each LFO
+        lfo.setseed(row + i);
     }
     for (uint i = 0; i < 3; ++i) {
         Osc &osc = osc_[i];
@@ -54,16 +160,50 @@ void Voice::initialize(f64 fs, uint bs, pb_alloc<> &alloc)
     vcf.setparam(&pgm_.misc);
 
     Sat &sat = sat_;
-    sat.initialize(fs, bs);
+    sat.initialize(fs, bs, mem);
 
     Dca4 &dca4 = dca4_;
     dca4.initialize(fs, bs);
     dca4.setparam(&pgm_.misc);
 }
 
+uint Voice::mod_row(Mod m) const
+{
+    // the rows of the voice skip the controllers, which are of the part
+    uint i = (uint)m;
+    if (i <= (uint)Mod::LFO3 && (lfo_mask_ & (1u << i)))
+        return lfo_row_ + i;
+    if (i < (uint)Mod::WHEEL)
+        return mod_row_ + i;
+    if (i > (uint)Mod::XCTRL)
+        return mod_row_ + i - 3;
+    return ctl_row_ + i - (uint)Mod::WHEEL;
+}
+
+uint Voice::common_lfos(const Program &main) const
+{
+    uint mask = 0;
+    for (uint i = 0; i < 3; ++i) {
+        const Lfo::Param &param = pgm_.lfos[i];
+        // the modulation is the same for all the voices of a part
+        Mod src = (Mod)param.MOD();
+        bool common = src == Mod::OFF || (src >= Mod::WHEEL && src <= Mod::XCTRL);
+        if (common && !param.RESET && !param.HUMAN &&
+            !memcmp(&param, &main.lfos[i], sizeof(param)))
+            mask |= 1u << i;
+    }
+    return mask;
+}
+
+void Voice::set_shared_lfos(uint mask, uint row)
+{
+    lfo_mask_ = mask;
+    lfo_row_ = row;
+}
+
 void Voice::reset()
 {
-    mod(Mod::PRESS)->clear();
+    mod(Mod::PRESS).clear();
 
     const Program &pgm = pgm_;
 
@@ -82,50 +222,48 @@ void Voice::reset()
     dca4_.reset();
 }
 
+uint Voice::level() const
+{
+    i8 env = env_[3].level();
+    return (uint)std::abs((int)env) * dca4_.gain();
+}
+
+void Voice::account_cost(f64 secs, uint nframes)
+{
+    // short segments weigh less, their overhead is not representative
+    f32 cost = secs / nframes;
+    f32 weight = std::min(1.0f, nframes * (1.0f / 256));
+    cost_ = (cost_ == 0) ? cost : (cost_ + (cost - cost_) * weight * 0.25f);
+}
+
+void Voice::set_quality(Quality q)
+{
+    for (uint i = 0; i < 3; ++i)
+        osc_[i].set_quality(q);
+    sat_.set_quality(q);
+    vcf_.set_quality(q);
+}
+
 void Voice::synthesize_adding(i16 *outl, i16 *outr, uint nframes)
 {
-    pb_alloc<> &alloc = *alloc_;
     const Program &pgm = pgm_;
     const Program::Misc &miscpar = pgm.misc;
     uint key = key_;
 
-    i16 *zeroin = (i16 *)alloc.unchecked_alloc(nframes * sizeof(i16));
-    SCOPE(exit)
-    {
-        alloc.free(zeroin);
-    };
-    std::fill(zeroin, zeroin + nframes, 0);
-
-    i16 *dummyout = (i16 *)alloc.unchecked_alloc(nframes * sizeof(i16));
-    SCOPE(exit)
-    {
-        alloc.free(dummyout);
+    // the rows of the scratch area, see scratch_size
+    i16 *scratch = scratch_;
+    size_t stride = arena::footprint(bs_ * sizeof(i16)) / sizeof(i16);
+    auto buffer = [scratch, stride](InsBuffer b) -> i16 * {
+        return scratch + (2 + Ins_buffer_plan.offset[b]) * stride;
     };
 
-    i16 *oscout[3] = {};
-    i16 *dcaout[3] = {};
+    assert(nframes <= bs_);
+    const i16 *zeroin = scratch;
+    i16 *dummyout = scratch + stride;
 
-    for (uint i = 0; i < 3; ++i)
-        oscout[i] = (i16 *)alloc.unchecked_alloc(nframes * sizeof(i16));
-    SCOPE(exit)
-    {
-        for (uint i = 0; i < 3; ++i)
-            alloc.free(oscout[2 - i]);
-    };
-
-    for (uint i = 0; i < 3; ++i)
-        dcaout[i] = (i16 *)alloc.unchecked_alloc(nframes * sizeof(i16));
-    SCOPE(exit)
-    {
-        for (uint i = 0; i < 3; ++i)
-            alloc.free(dcaout[2 - i]);
-    };
-
-    i8 *syncout = (i8 *)alloc.unchecked_alloc(nframes);
-    SCOPE(exit)
-    {
-        alloc.free(syncout);
-    };
+    i16 *oscout[3] = {buffer(Ins_oscout0), buffer(Ins_oscout1), buffer(Ins_oscout2)};
+    i16 *dcaout[3] = {buffer(Ins_dcaout0), buffer(Ins_dcaout1), buffer(Ins_dcaout2)};
+    i8 *syncout = (i8 *)buffer(Ins_syncout);
 
     // TODO synthesize
     for (uint i = 0; i < 3; ++i) {
@@ -134,92 +272,126 @@ void Voice::synthesize_adding(i16 *outl, i16 *outr, uint nframes)
 
         const Osc::Param &oscpar = pgm.oscs[i];
 
-        const i8 *oscmods[2] = {mod((Mod)oscpar.FMSRC1)->for_input(nframes),
-                                mod((Mod)oscpar.FMSRC2)->for_input(nframes)};
+        const i8 *oscmods[2] = {mod((Mod)oscpar.FMSRC1).for_input(nframes),
+                                mod((Mod)oscpar.FMSRC2).for_input(nframes)};
         const i8 oscmodamts[2] = {oscpar.FCMODAMT1, oscpar.FCMODAMT2};
 
         osc.generate(oscout[i], (i == 1 && miscpar.SYNC) ? syncout : (const i8 *)zeroin,
                      (i == 0) ? syncout : (i8 *)dummyout, oscmods, oscmodamts, key, nframes);
 
-        const i8 *dcamods[2] = {mod((Mod)oscpar.AMSRC1)->for_input(nframes),
-                                mod((Mod)oscpar.AMSRC2)->for_input(nframes)};
+        const i8 *dcamods[2] = {mod((Mod)oscpar.AMSRC1).for_input(nframes),
+                                mod((Mod)oscpar.AMSRC2).for_input(nframes)};
         const i8 dcamodamts[2] = {oscpar.AMAMT1, oscpar.AMAMT2};
 
         dca.generate(dcaout[i], oscout[i], (i == 1 && miscpar.AM) ? oscout[0] : zeroin,
                      dcamods, dcamodamts, nframes);
     }
 
-    i32 *satin = (i32 *)alloc.unchecked_alloc(nframes * sizeof(i32));
-    SCOPE(exit)
-    {
-        alloc.free(satin);
-    };
+    i32 *satin = (i32 *)buffer(Ins_satin);
 
     for (uint i = 0; i < nframes; ++i)
         satin[i] = (i32)dcaout[0][i] + (i32)dcaout[1][i] + (i32)dcaout[2][i];
 
-    i16 *satout = (i16 *)alloc.unchecked_alloc(nframes * sizeof(i16));
-    SCOPE(exit)
-    {
-        alloc.free(satout);
-    };
+    i16 *satout = buffer(Ins_satout);
 
     Sat &sat = sat_;
     sat.generate(satin, satout, nframes);
 
-    i16 *vcfout = (i16 *)alloc.unchecked_alloc(nframes * sizeof(i16));
-    SCOPE(exit)
-    {
-        alloc.free(vcfout);
-    };
+    i16 *vcfout = buffer(Ins_vcfout);
 
-    const i8 *vcfmods[2] = {mod((Mod)miscpar.FCSRC1)->for_input(nframes),
-                            mod((Mod)miscpar.FCSRC2)->for_input(nframes)};
+    const i8 *vcfmods[2] = {mod((Mod)miscpar.FCSRC1).for_input(nframes),
+                            mod((Mod)miscpar.FCSRC2).for_input(nframes)};
     const i8 vcfmodamts[2] = {miscpar.FCMODAMT1, miscpar.FCMODAMT2};
 
     Vcf &vcf = vcf_;
     vcf.generate(vcfout, satout, vcfmods, vcfmodamts, key, nframes);
 
     Dca4 &dca4 = dca4_;
-    const i8 *dca4mod = mod(Mod::ENV4)->for_input(nframes);
-    const i8 *panmod = mod((Mod)miscpar.PANMODSRC)->for_input(nframes);
+    const i8 *dca4mod = mod(Mod::ENV4).for_input(nframes);
+    const i8 *panmod = mod((Mod)miscpar.PANMODSRC).for_input(nframes);
     dca4.generate_adding(outl, outr, vcfout, dca4mod, panmod, nframes);
 
     // prepare for the next new MIDI sequence
-    mod(Mod::PRESS)->cycle();
+    mod(Mod::PRESS).cycle();
 }
 
 void Voice::synthesize_mods(uint nframes)
 {
     const Program &pgm = pgm_;
 
-    mod(Mod::PRESS)->repeat_upto(nframes - 1);
+    mod(Mod::PRESS).repeat_upto(nframes - 1);
 
     i8 kybd = key_ / 2;
     i8 kybd2 = clamp((((int)key_ - 36) * 126 / 60), 0, 126) - 63;
     i8 vel = vel_ / 2;
     i8 vel2 = Ins_vel2_table[vel_];
-    mod(Mod::KYBD)->fill_entire(kybd, nframes);
-    mod(Mod::KYBD2)->fill_entire(kybd2, nframes);
-    mod(Mod::VEL)->fill_entire(vel, nframes);
-    mod(Mod::VEL2)->fill_entire(vel2, nframes);
+    mod(Mod::KYBD).fill_entire(kybd, nframes);
+    mod(Mod::KYBD2).fill_entire(kybd2, nframes);
+    mod(Mod::VEL).fill_entire(vel, nframes);
+    mod(Mod::VEL2).fill_entire(vel2, nframes);
 
     for (uint i = 0; i < 4; ++i) {
         Env &env = env_[i];
         Mod dst = (Mod)((int)Mod::ENV1 + i);
-        env.generate(mod(dst)->for_output(nframes), nframes);
+        env.generate(mod(dst).for_output(nframes), nframes);
     }
 
     //
     for (uint i = 0; i < 3; ++i) {
+        if (lfo_mask_ & (1u << i))
+            continue;
         Lfo &lfo = lfo_[i];
         const Lfo::Param &param = pgm.lfos[i];
         Mod dst = (Mod)((int)Mod::LFO1 + i);
         Mod src = (Mod)param.MOD();
-        lfo.generate(mod(dst)->for_output(nframes), mod(src)->for_input(nframes), nframes);
+        lfo.generate(mod(dst).for_output(nframes), mod(src).for_input(nframes), nframes);
     }
 }
 
+void Voice::update_parameters(const Program &src, const parambits &changed)
+{
+    Program &pgm = pgm_;
+
+    enum { Env1 = 1, Vcf1 = 1 << 4, Dca41 = 1 << 5 };
+    uint refresh = 0;
+
+    for (uint w = 0, nw = changed.size(); w < nw; ++w) {
+        for (u64 bits = changed[w]; bits; bits &= bits - 1) {
+            uint idx = 64 * w + ctz(bits);
+            pgm.set_parameter(idx, src.get_parameter(idx));
+
+            if (idx < Param::first_lfo_param)
+                refresh |= Env1 << (idx / Param::env_params);
+            else {
+                switch (idx) {
+                case P_Misc_FLTFC:
+                case P_Misc_Q:
+                case P_Misc_KEYBD:
+                    refresh |= Vcf1;
+                    break;
+                case P_Misc_DCA4MODAMT:
+                case P_Misc_PAN:
+                case P_Misc_PANMODAMT:
+                    refresh |= Dca41;
+                    break;
+                default:
+                    // read directly by the component
+                    break;
+                }
+            }
+        }
+    }
+
+    for (uint i = 0; i < 4; ++i) {
+        if (refresh & (Env1 << i))
+            env_[i].refresh();
+    }
+    if (refresh & Vcf1)
+        vcf_.refresh();
+    if (refresh & Dca41)
+        dca4_.refresh();
+}
+
 void Voice::trigger(uint key, uint vel, uint ftime)
 {
     const Program &pgm = pgm_;
@@ -245,53 +417,153 @@ void Voice::release(uint vel, uint ftime)
         env_[i].release(vel);
 }
 
+void Voice::fade(uint frames)
+{
+    for (uint i = 0; i < 3; ++i)
+        env_[i].release(vel_);
+    env_[3].fade(frames);
+}
+
 void Voice::handle_aftertouch(uint vel, uint ftime)
 {
-    mod(Mod::PRESS)->append(ftime, vel / 2);
+    mod(Mod::PRESS).append(ftime, vel / 2);
 }
 
 //------------------------------------------------------------------------------
-Instrument::Instrument(FxMaster &master)
+Instrument::Instrument(FxMaster &master, BankPool::Storage *banks)
+    : bank_pool_(banks)
 {
     master_ = &master;
+    automation_slot_.fill(0xff);
+
+    // the host will likely initialize at one of these rates
+    prebuild_rate_tables();
+
+    for (uint p = 0; p < polymax; ++p)
+        vclists_.push_back(free_voices, p);
 
     load_default_banks();
     enable_program(selected_program());
+    program_snapshot_.store(program_);
 }
 
-void Instrument::initialize(f64 fs, uint bs)
+Instrument::~Instrument()
+{
+    if (locked_) {
+        unlock_memory(mem_.data(), mem_.capacity());
+        unlock_memory(this, sizeof(*this));
+    }
+}
+
+void *Instrument::operator new(size_t size)
 {
-    pb_alloc<> &alloc = alloc_;
-    alloc = pb_alloc<>(allocatable_buffers * bs * sizeof(i32));
+    void *ptr = aligned_malloc(size, alignof(Instrument));
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
 
-    mb_wheel_ = std::make_shared<mod_buffer>(bs);
-    mb_pedal_ = std::make_shared<mod_buffer>(bs);
-    mb_xctrl_ = std::make_shared<mod_buffer>(bs);
+void Instrument::operator delete(void *ptr) noexcept
+{
+    aligned_free(ptr);
+}
+
+void Instrument::initialize(f64 fs, uint bs)
+{
+    if (bs > max_block)
+        bs = max_block;
+
+    // all the memory in one piece, nothing allocates after this
+    //  the voices render in turn, and share the working buffers
+    size_t scratch = Voice::scratch_size(bs);
+    arena &mem = mem_;
+    uint modrows = lfo_row(max_parts);
+    // the arena which replaces a locked one is locked too
+    if (locked_)
+        unlock_memory(mem.data(), mem.capacity());
+    mem = arena(arena::footprint(scratch) + mod_matrix::memory_size(modrows, bs) +
+                polymax * Voice::memory_size(bs));
+    if (locked_)
+        lock_memory(mem.data(), mem.capacity());
+
+    scratch_ = (i16 *)mem.allocate(scratch);
+
+    mod_matrix &mods = mods_;
+    mods.initialize(modrows, bs, mem);
 
     for (uint p = 0; p < polymax; ++p) {
         Voice &vc = voices_[p];
-        vc.initialize(fs, bs, alloc);
-        vc.mod(Mod::WHEEL) = mb_wheel_;
-        vc.mod(Mod::PEDAL) = mb_pedal_;
-        vc.mod(Mod::XCTRL) = mb_xctrl_;
+        vc.initialize(fs, bs, mods, p * Voice::mod_rows, scratch_, mem);
+        vc.set_quality(quality_);
+        vc.set_controller_row(controller_row(0));
+        vcpart_[p] = 0;
+    }
+
+    for (uint part = 0; part < max_parts; ++part) {
+        for (uint i = 0; i < 3; ++i) {
+            Lfo &lfo = parts_[part].lfos[i];
+            lfo.initialize(fs, bs);
+            lfo.setseed(lfo_row(part) + i);
+        }
     }
 
+    budget_.initialize(fs);
     fs_ = fs;
+    bs_ = bs;
 }
 
-void Instrument::initialize_tables()
+Instrument::Residency Instrument::activate(bool lock)
 {
-    if (Ins_tables_init)
-        return;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Residency res;
 
-    std::lock_guard<std::mutex> lock(Ins_tables_mutex);
-    if (Ins_tables_init)
-        return;
+    // the instrument, whose memory is unlocked with it
+    const memory_region own[] = {
+        {this, sizeof(*this)},
+        {mem_.data(), mem_.capacity()},
+    };
+    // the data of the process, read by all instruments
+    const memory_region shared[] = {
+        {&rom_data, sizeof(rom_data)},
+        {&rate_tables(fs_), sizeof(RateTables)},
+        Sat::shared_table(),
+        {&Ins_vel2_table, sizeof(Ins_vel2_table)},
+        {Pan_table.data(), sizeof(Pan_table)},
+        {Env_times.data(), sizeof(Env_times)},
+        {Lfo_freqs.data(), sizeof(Lfo_freqs)},
+        {Lfo_delays.data(), sizeof(Lfo_delays)},
+        {Vcf_freqs.data(), sizeof(Vcf_freqs)},
+#ifdef CWS_FIXED_POINT_FIR_FILTERS
+        {Sat_aa2x.data(), sizeof(Sat_aa2x)},
+        {Sat_aa4x.data(), sizeof(Sat_aa4x)},
+        {Sat_aa4x_hq.data(), sizeof(Sat_aa4x_hq)},
+#else
+        {Sat_aa2x_real.data(), sizeof(Sat_aa2x_real)},
+        {Sat_aa4x_real.data(), sizeof(Sat_aa4x_real)},
+        {Sat_aa4x_hq_real.data(), sizeof(Sat_aa4x_hq_real)},
+#endif
+    };
 
-    scoped_fesetround(FE_TONEAREST);
+    if (locked_ && !lock) {
+        for (const memory_region &r : own)
+            unlock_memory(r.data, r.size);
+        locked_ = false;
+    }
 
-    for (uint i = 0; i < 127; ++i)
-        Ins_vel2_table[i] = lrint(63.0 * sin(acos((127.0 - i) / 127.0)));
+    auto bring = [&res, lock](const memory_region &r) {
+        prefault_memory(r.data, r.size);
+        res.bytes += r.size;
+        if (lock && lock_memory(r.data, r.size))
+            res.locked += r.size;
+    };
+    for (const memory_region &r : own)
+        bring(r);
+    for (const memory_region &r : shared)
+        bring(r);
+    locked_ = lock;
+
+    res.time = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+    return res;
 }
 
 void Instrument::select_program(uint banknum, uint prognum)
@@ -299,10 +571,9 @@ void Instrument::select_program(uint banknum, uint prognum)
     if (banknum == banknum_ && prognum == prognum_)
         return;
 
-    Bank &bank = banks_[banknum];
+    const Bank &bank = *banks_[banknum];
     enable_program(bank.pgm[prognum]);
     should_notify_program_ = true;
-    bank.pgm_count = std::min<uint>(bank.pgm_count, prognum + 1);
     banknum_ = banknum;
     prognum_ = prognum;
 }
@@ -310,31 +581,161 @@ void Instrument::select_program(uint banknum, uint prognum)
 void Instrument::enable_program(const Program &pgm)
 {
     program_ = pgm;
+    ramping_.clear();
+    program_dirty_.fill(0);
     vcforeign_.set();
+    ++parts_[0].serial;
     should_notify_program_ = true;
+    program_changed_ = true;
+}
+
+void Instrument::select_part_program(uint part, uint banknum, uint prognum)
+{
+    assert(part < max_parts && banknum < 4 && prognum < Bank::max_programs);
+
+    if (part == 0)
+        return select_program(banknum, prognum);
+
+    Part &pt = parts_[part];
+    if (banknum == pt.banknum && prognum == pt.prognum)
+        return;
+
+    pt.banknum = banknum;
+    pt.prognum = prognum;
+    ++pt.serial;
+}
+
+const Program &Instrument::part_program(uint part) const
+{
+    if (part == 0)
+        return program_;
+    const Part &pt = parts_[part];
+    return banks_[pt.banknum]->pgm[pt.prognum];
+}
+
+const Bank &Instrument::part_bank(uint part) const
+{
+    return *banks_[(part == 0) ? banknum_ : parts_[part].banknum];
+}
+
+uint Instrument::key_programs(uint part, uint key, const Program *pgms[2]) const
+{
+    const Program &main = part_program(part);
+    const Program::Misc &misc = main.misc;
+    const Bank &bank = part_bank(part);
+    uint count = 0;
+
+    // the split zone is under the split point, or above with SPLITDIR
+    //  a program past the end of the bank is empty, and is not played
+    uint pgm_count = bank.pgm_count;
+    bool split = misc.SPLIT && misc.SPLITPRG < pgm_count &&
+        (misc.SPLITDIR ? (key >= misc.SPLITPOINT) : (key < misc.SPLITPOINT));
+
+    if (!split) {
+        pgms[count++] = &main;
+        if (misc.LAYER && misc.LAYERPRG < pgm_count)
+            pgms[count++] = &bank.pgm[misc.LAYERPRG];
+    }
+    else {
+        pgms[count++] = &bank.pgm[misc.SPLITPRG];
+        if (misc.SPLITLAYER && misc.SPLITLAYERPRG < pgm_count)
+            pgms[count++] = &bank.pgm[misc.SPLITLAYERPRG];
+    }
+
+    return count;
 }
 
 i32 Instrument::get_parameter(uint idx) const
 {
-    return program_.get_parameter(idx);
+    if (idx >= Param::num_params)
+        return 0;
+
+    // a value set, but not applied yet
+    u64 bit = (u64)1 << (idx % 64);
+    if (parameter_dirty_[idx / 64].load(std::memory_order_acquire) & bit)
+        return parameter_slots_[idx].load(std::memory_order_relaxed);
+
+    return program_snapshot_.load().get_parameter(idx);
 }
 
 void Instrument::set_parameter(uint idx, i32 val)
 {
-    if (program_.set_parameter(idx, val))
-        should_notify_program_ = true;
+    if (idx >= Param::num_params)
+        return;
+
+    val = Program::clamp_parameter_value(idx, val);
+    parameter_slots_[idx].store(val, std::memory_order_relaxed);
+
+    u64 bit = (u64)1 << (idx % 64);
+    parameter_dirty_[idx / 64].fetch_or(bit, std::memory_order_release);
 }
 
 void Instrument::set_f32_parameter(uint idx, f32 val)
 {
-    if (program_.set_f32_parameter(idx, val))
-        should_notify_program_ = true;
+    std::pair<i32, i32> range = Program::get_parameter_range(idx);
+    i32 min = range.first, max = range.second;
+    set_parameter(idx, (i32)(min + val * (max - min)));
+}
+
+void Instrument::apply_parameter(uint idx, i32 val)
+{
+    if (program_.set_parameter(idx, val))
+        mark_parameter_changed(idx);
+}
+
+void Instrument::mark_parameter_changed(uint idx)
+{
+    u64 bit = (u64)1 << (idx % 64);
+    program_dirty_[idx / 64] |= bit;
+    parameters_to_notify_[idx / 64] |= bit;
+    program_changed_ = true;
+}
+
+void Instrument::mark_bank_changed(uint num)
+{
+    bank_slots_to_notify_[num].fill(~(u64)0);
+}
+
+void Instrument::mark_bank_slot_changed(uint num, uint slot)
+{
+    bank_slots_to_notify_[num][slot / 64] |= (u64)1 << (slot % 64);
+}
+
+void Instrument::update_voice_parameters()
+{
+    parambits &dirty = program_dirty_;
+
+    u64 any = 0;
+    for (u64 bits : dirty)
+        any |= bits;
+    if (!any)
+        return;
+
+    for (uint vnum : vclists_.range(active_voices)) {
+        if (!vcforeign_[vnum])
+            voices_[vnum].update_parameters(program_, dirty);
+    }
+
+    dirty.fill(0);
+}
+
+void Instrument::collect_parameters()
+{
+    for (uint w = 0, nw = parameter_dirty_.size(); w < nw; ++w) {
+        u64 bits = parameter_dirty_[w].exchange(0, std::memory_order_acquire);
+        for (; bits; bits &= bits - 1) {
+            uint idx = 64 * w + ctz(bits);
+            automate_parameter(idx, parameter_slots_[idx].load(std::memory_order_relaxed), 0);
+        }
+    }
 }
 
 void Instrument::rename_program(const char *name)
 {
-    if (program_.rename(name))
+    if (program_.rename(name)) {
         should_notify_program_ = true;
+        program_changed_ = true;
+    }
 }
 
 char *Instrument::program_name(char namebuf[8]) const
@@ -342,13 +743,17 @@ char *Instrument::program_name(char namebuf[8]) const
     return program_.name(namebuf);
 }
 
-void Instrument::load_default_banks()
+static std::array<std::shared_ptr<const Bank>, 4> Ins_make_default_banks()
 {
-    banks_[0] = load_factory_bank();
+    std::array<std::shared_ptr<Bank>, 4> banks;
+    for (std::shared_ptr<Bank> &bank : banks)
+        bank = std::make_shared<Bank>();
+
+    *banks[0] = load_factory_bank();
 
     for (uint i = 0; i < 4; ++i)
         for (uint j = (i == 0) ? 40 : 0; j < 128; ++j)
-            banks_[i].pgm[j].rename("------");
+            banks[i]->pgm[j].rename("------");
 
     uint bnum = 0;
     uint pnum = 41;
@@ -357,9 +762,9 @@ void Instrument::load_default_banks()
         Bank bank = Bank::load_sysex(data.data(), data.size());
         assert(bank.pgm_count == 40);
         //
-        banks_[bnum].pgm_count = pnum + 40;
+        banks[bnum]->pgm_count = pnum + 40;
         for (uint i = 0; i < 40; ++i)
-            banks_[bnum].pgm[pnum + i] = bank.pgm[i];
+            banks[bnum]->pgm[pnum + i] = bank.pgm[i];
         //
         pnum += 41;
         if (128 - pnum < 40) {
@@ -368,42 +773,262 @@ void Instrument::load_default_banks()
         }
     }
 
-    bank_notification_mask_ = (1u << 4) - 1;
+    return {{banks[0], banks[1], banks[2], banks[3]}};
+}
+
+void Instrument::load_default_banks()
+{
+    const std::array<std::shared_ptr<const Bank>, 4> &defaults = Ins_default_banks();
+
+    for (uint i = 0; i < 4; ++i) {
+        set_bank(i, nullptr, defaults[i]);
+        mark_bank_changed(i);
+    }
 }
 
 void Instrument::load_bank(uint index, const Bank &bank)
 {
     assert(index < 4);
-    banks_[index] = bank;
-    bank_notification_mask_ |= 1u << index;
+    Bank *dst = writable_bank(index);
+    if (!dst)
+        return;
+    *dst = bank;
+    mark_bank_changed(index);
+}
+
+void Instrument::set_bank(uint num, Bank *own, std::shared_ptr<const Bank> shared)
+{
+    if (Bank *old = own_banks_[num])
+        bank_pool_.retire(old);
+    own_banks_[num] = own;
+    shared_banks_[num] = std::move(shared);
+    banks_[num] = own ? own : shared_banks_[num].get();
+
+    // a free bank for each shared one, which a write may copy
+    uint count = 0;
+    for (const Bank *bank : own_banks_)
+        count += !bank;
+    bank_pool_.reserve(count);
+}
+
+Bank *Instrument::writable_bank(uint num)
+{
+    Bank *bank = own_banks_[num];
+    if (bank)
+        return bank;
+
+    bank = bank_pool_.acquire_reserved();
+    if (!bank)
+        return nullptr;
+    *bank = *banks_[num];
+    set_bank(num, bank, nullptr);
+    return bank;
+}
+
+void Instrument::set_polyphony(uint poly)
+{
+    poly_ = std::max(1u, std::min(poly, (uint)polymax));
+}
+
+void Instrument::set_quality(Quality q)
+{
+    for (Voice &vc : voices_)
+        vc.set_quality(q);
+    quality_ = q;
 }
 
 void Instrument::select_xctrl(uint c)
 {
     xctrl_ = c;
-    mb_xctrl_->clear();
+    for (uint p = 0; p < max_parts; ++p)
+        controller(p, Mod::XCTRL).clear();
 }
 
 void Instrument::reset()
 {
-    for (uint vcnum : vcorder_) {
-        voices_[vcnum].reset();
-        vcallocd_[vcnum] = false;
+    for (uint vnum : vclists_.range(active_voices))
+        voices_[vnum].reset();
+    vckeys_.clear();
+    vclists_.clear();
+    for (uint p = 0; p < polymax; ++p)
+        vclists_.push_back(free_voices, p);
+
+    for (uint p = 0; p < max_parts; ++p) {
+        controller(p, Mod::WHEEL).clear();
+        controller(p, Mod::PEDAL).clear();
+        controller(p, Mod::XCTRL).clear();
+        if (p > 0)
+            select_part_program(p, 0, 0);
     }
-    vcorder_.clear();
-
-    mb_wheel_->clear();
-    mb_pedal_->clear();
-    mb_xctrl_->clear();
 
     load_default_banks();
     select_program(0, 0);
 }
 
 void Instrument::synthesize(i16 *outl, i16 *outr, uint nframes)
+{
+    synthesize(outl, outr, nframes, nullptr, 0);
+}
+
+void Instrument::synthesize(i16 *outl, i16 *outr, uint nframes,
+                            const MidiEvent *events, uint nevents)
 {
     emit_notifications();
+    collect_parameters();
+
+    std::sort(
+        automation_.begin(), automation_.end(),
+        [](const Automation &a, const Automation &b) -> bool { return a.ftime < b.ftime; });
+
+    uint ai = 0;
+    uint ei = 0;
+    for (uint start = 0; start < nframes;) {
+        // parameters as they are at the start of the segment
+        run_automation(start, ai);
+
+        // the segment ends at the next event which affects voices
+        uint end = nframes;
+        for (uint i = ei; i < nevents; ++i) {
+            const MidiEvent &ev = events[i];
+            uint ftime = std::min(ev.ftime, nframes - 1);
+            if (ftime > start && midi_splits_block(ev.msg, ev.len)) {
+                end = ftime;
+                break;
+            }
+        }
+        if (ai < automation_.size())
+            end = std::min(end, automation_[ai].ftime);
+        if (!ramping_.empty())
+            end = std::min(end, start + ramp_segment);
+        end = std::min(end, start + bs_);
+
+        // receive the events of the segment, relative to its start
+        for (; ei < nevents; ++ei) {
+            const MidiEvent &ev = events[ei];
+            uint ftime = std::min(ev.ftime, nframes - 1);
+            if (ftime >= end)
+                break;
+            receive_midi(ev.msg, ev.len, (ftime > start) ? (ftime - start) : 0);
+        }
+
+        update_voice_parameters();
+        render(outl + start, outr + start, end - start);
+        start = end;
+    }
+
+    // remaining events, only if the block is empty
+    for (; ei < nevents; ++ei) {
+        const MidiEvent &ev = events[ei];
+        run_automation(0, ai);
+        receive_midi(ev.msg, ev.len, 0);
+    }
+
+    run_automation(nframes, ai);
+    clear_automation();
 
+    budget_.end_block(poly_);
+    shed_voices();
+
+    // make changes visible to other threads
+    if (program_changed_) {
+        program_snapshot_.store(program_);
+        program_changed_ = false;
+    }
+}
+
+void Instrument::run_automation(uint ftime, uint &index)
+{
+    uint ai = index;
+    uint na = automation_.size();
+
+    for (; ai < na && automation_[ai].ftime <= ftime; ++ai) {
+        const Automation &a = automation_[ai];
+        uint idx = a.index;
+        advance_ramps(a.ftime);
+
+        Ramp &ramp = ramps_[idx];
+        bool running = std::find(ramping_.begin(), ramping_.end(), idx) != ramping_.end();
+        uint frames = ramp_frames_[idx];
+
+        if (frames == 0) {
+            if (running)
+                ramping_.erase(std::find(ramping_.begin(), ramping_.end(), idx));
+            apply_parameter(idx, a.value);
+        }
+        else {
+            f32 value = running ? ramp.value : (f32)program_.get_parameter(idx);
+            ramp.value = value;
+            ramp.step = (a.value - value) / frames;
+            ramp.target = a.value;
+            ramp.remain = frames;
+            if (!running)
+                ramping_.push_back(idx);
+        }
+    }
+
+    index = ai;
+    advance_ramps(ftime);
+}
+
+void Instrument::advance_ramps(uint ftime)
+{
+    if (ftime <= ramp_time_)
+        return;
+
+    uint dt = ftime - ramp_time_;
+    ramp_time_ = ftime;
+
+    for (uint i = ramping_.size(); i-- > 0;) {
+        uint idx = ramping_[i];
+        Ramp &ramp = ramps_[idx];
+        uint n = std::min(dt, ramp.remain);
+        ramp.value += n * ramp.step;
+        ramp.remain -= n;
+        if (ramp.remain > 0)
+            apply_parameter(idx, (i32)lround(ramp.value));
+        else {
+            apply_parameter(idx, ramp.target);
+            ramping_.erase(&ramping_[i]);
+        }
+    }
+}
+
+void Instrument::clear_automation()
+{
+    for (const Automation &a : automation_)
+        automation_slot_[a.index] = 0xff;
+    automation_.clear();
+    ramp_time_ = 0;
+}
+
+void Instrument::automate_parameter(uint idx, i32 val, uint ftime)
+{
+    if (idx >= Param::num_params)
+        return;
+
+    uint slot = automation_slot_[idx];
+    if (slot != 0xff) {
+        // keep only the last point of the block
+        Automation &a = automation_[slot];
+        a.ftime = ftime;
+        a.value = val;
+    }
+    else {
+        automation_slot_[idx] = automation_.size();
+        automation_.push_back(Automation{ftime, idx, val});
+    }
+}
+
+void Instrument::set_parameter_ramp(uint idx, uint frames)
+{
+    if (idx >= Param::num_params)
+        return;
+
+    ramp_frames_[idx] = frames;
+}
+
+void Instrument::render(i16 *outl, i16 *outr, uint nframes)
+{
     //
     synthesize_mods(nframes);
 
@@ -411,9 +1036,25 @@ void Instrument::synthesize(i16 *outl, i16 *outr, uint nframes)
     std::fill(outl, outl + nframes, 0);
     std::fill(outr, outr + nframes, 0);
 
-    for (uint vnum : vcorder_) {
-        Voice &vc = voices_[vnum];
-        vc.synthesize_adding(outl, outr, nframes);
+    if (!budget_.enabled()) {
+        for (uint vnum : vclists_.range(active_voices)) {
+            Voice &vc = voices_[vnum];
+            vc.synthesize_adding(outl, outr, nframes);
+        }
+    }
+    else {
+        namespace stc = std::chrono;
+        stc::steady_clock::time_point start = stc::steady_clock::now();
+        stc::steady_clock::time_point t1 = start;
+        for (uint vnum : vclists_.range(active_voices)) {
+            Voice &vc = voices_[vnum];
+            vc.synthesize_adding(outl, outr, nframes);
+            stc::steady_clock::time_point t2 = stc::steady_clock::now();
+            vc.account_cost(stc::duration<f64>(t2 - t1).count(), nframes);
+            t1 = t2;
+        }
+        budget_.account(stc::duration<f64>(t1 - start).count(), nframes,
+                        vclists_.size(active_voices));
     }
 
     // TODO synthesize
@@ -423,21 +1064,41 @@ void Instrument::synthesize(i16 *outl, i16 *outr, uint nframes)
     shutdown_idle_voices();
 
     // prepare for the next new MIDI sequence
-    mb_wheel_->cycle();
-    mb_pedal_->cycle();
-    mb_xctrl_->cycle();
-
-    // check temporary memory is released
-    assert(alloc_.empty());
+    for (uint r = controller_row(0); r < controller_row(max_parts); ++r)
+        mods_.row(r).cycle();
 }
 
 void Instrument::synthesize_mods(uint nframes)
 {
-    mb_wheel_->repeat_upto(nframes - 1);
-    mb_pedal_->repeat_upto(nframes - 1);
-    mb_xctrl_->repeat_upto(nframes - 1);
+    for (uint r = controller_row(0); r < controller_row(max_parts); ++r)
+        mods_.row(r).repeat_upto(nframes - 1);
+
+    // the shared LFOs which the voices read, by part
+    std::array<u8, max_parts> lfos_used{};
+    bool shared = shared_lfos_;
+    for (uint vnum : vclists_.range(active_voices)) {
+        Voice &vc = voices_[vnum];
+        uint part = vcpart_[vnum];
+        uint mask = shared ? vc.common_lfos(part_program(part)) : 0;
+        vc.set_shared_lfos(mask, lfo_row(part));
+        lfos_used[part] |= mask;
+    }
 
-    for (uint vnum : vcorder_) {
+    for (uint part = 0; part < max_parts; ++part) {
+        for (uint mask = lfos_used[part]; mask; mask &= mask - 1) {
+            uint i = ctz(mask);
+            Lfo &lfo = parts_[part].lfos[i];
+            const Lfo::Param &param = part_program(part).lfos[i];
+            lfo.setparam(&param);
+            // a zero row if not a controller
+            Mod src = (Mod)param.MOD();
+            const i8 *modp = (src == Mod::OFF) ? (const i8 *)scratch_
+                                               : controller(part, src).for_input(nframes);
+            lfo.generate(mods_.row(lfo_row(part) + i).for_output(nframes), modp, nframes);
+        }
+    }
+
+    for (uint vnum : vclists_.range(active_voices)) {
         Voice &vc = voices_[vnum];
         vc.synthesize_mods(nframes);
     }
@@ -464,19 +1125,17 @@ void Instrument::receive_request(const Request::T &req)
 
     case RequestType::LoadBank: {
         auto &loadbank = (const Request::LoadBank &)req;
-        const Bank &data = loadbank.data;
-        uint count = data.pgm_count;
-        if (count >= 128)
+        Bank *data = bank_pool_.bank(loadbank.index);
+        if (!data)
+            return;
+        if (data->pgm_count >= 128) {
+            bank_pool_.retire(data);
             return;
+        }
         uint banknum = banknum_;
-        Bank &currbank = banks_[banknum];
-        for (uint i = 0; i < count; ++i)
-            currbank.pgm[i] = data.pgm[i];
-        const Program &initpgm = initial_program();
-        for (uint i = count; i < 128; ++i)
-            currbank.pgm[i] = initpgm;
-        bank_notification_mask_ |= 1u << banknum;
-        enable_program(currbank.pgm[prognum_]);
+        set_bank(banknum, data, nullptr);
+        mark_bank_changed(banknum);
+        enable_program(banks_[banknum]->pgm[prognum_]);
         break;
     }
 
@@ -484,6 +1143,7 @@ void Instrument::receive_request(const Request::T &req)
         auto &renamepgm = (const Request::RenameProgram &)req;
         std::copy_n(renamepgm.name, 6, program_.NAME);
         should_notify_program_ = true;
+        program_changed_ = true;
         break;
     }
 
@@ -493,17 +1153,19 @@ void Instrument::receive_request(const Request::T &req)
     }
 
     case RequestType::WriteProgram: {
-        Bank &currbank = banks_[banknum_];
-        currbank.pgm[prognum_] = program_;
+        Bank *currbank = writable_bank(banknum_);
+        if (!currbank)
+            break;
+        currbank->pgm[prognum_] = program_;
+        mark_bank_slot_changed(banknum_, prognum_);
         should_notify_write_ = true;
         break;
     }
 
     case RequestType::SetParameter: {
         auto &setpm = (const Request::SetParameter &)req;
-        Program &pgm = program_;
-        if (pgm.set_parameter(setpm.index, setpm.value))
-            should_notify_program_ = true;
+        if (setpm.index < Param::num_params)
+            apply_parameter(setpm.index, setpm.value);
         break;
     }
 
@@ -512,19 +1174,19 @@ void Instrument::receive_request(const Request::T &req)
         u32 num = getbd.bank;
         if (num >= 4)
             return;
-        bank_notification_mask_ |= 1u << num;
+        mark_bank_changed(num);
         break;
     }
 
     case RequestType::NoteOn: {
         auto &note = (const Request::NoteOn &)req;
-        handle_noteon(note.key, note.velocity, 0);
+        handle_noteon(0, note.key, note.velocity, 0);
         break;
     }
 
     case RequestType::NoteOff: {
         auto &note = (const Request::NoteOff &)req;
-        handle_noteoff(note.key, note.velocity, 0);
+        handle_noteoff(0, note.key, note.velocity, 0);
         break;
     }
 
@@ -536,6 +1198,7 @@ void Instrument::receive_request(const Request::T &req)
 void Instrument::emit_notifications()
 {
     FxMaster *master = master_;
+    size_t budget = notification_budget;
 
     if (should_notify_write_) {
         Notification::Write ntf;
@@ -547,26 +1210,110 @@ void Instrument::emit_notifications()
 
     bexpected = true;
     if (should_notify_program_.compare_exchange_weak(bexpected, false)) {
+        program_snapshot_.store(program_);
+        program_changed_ = false;
+        // the whole program includes the changed parameters
+        parameters_to_notify_.fill(0);
+
         Notification::Program ntf;
         ntf.bank = banknum_;
         ntf.prog = prognum_;
         ntf.data = program_;
-        if (!master->emit_notification(ntf))
+        if (!master->emit_notification(ntf)) {
             should_notify_program_.store(true);
+            return;
+        }
+        budget -= std::min(budget, sizeof(ntf));
+    }
+
+    if (emit_parameter_notifications(budget))
+        emit_bank_notifications(budget);
+}
+
+bool Instrument::emit_parameter_notifications(size_t &budget)
+{
+    FxMaster *master = master_;
+    parambits &pending = parameters_to_notify_;
+
+    for (uint w = 0, nw = pending.size(); w < nw;) {
+        if (!pending[w]) {
+            ++w;
+            continue;
+        }
+        if (budget < sizeof(Notification::Parameters))
+            return false;
+
+        Notification::Parameters ntf;
+        parambits sent{};
+        uint count = 0;
+        for (uint v = w; v < nw && count < ntf.max_count; ++v) {
+            for (u64 bits = pending[v]; bits && count < ntf.max_count; bits &= bits - 1) {
+                uint idx = 64 * v + ctz(bits);
+                ntf.index[count] = idx;
+                ntf.value[count] = program_.get_parameter(idx);
+                sent[v] |= bits & ~(bits - 1);
+                ++count;
+            }
+        }
+        ntf.count = count;
+
+        if (!master->emit_notification(ntf))
+            return false;
+        for (uint v = w; v < nw; ++v)
+            pending[v] &= ~sent[v];
+        budget -= sizeof(ntf);
     }
 
-    if (bank_notification_mask_) {
-        uint i = 0;
-        while (i < 4 && !(bank_notification_mask_ & (1u << i)))
-            ++i;
-        if (i < 4) {
-            Notification::Bank ntf;
-            ntf.num = i;
-            ntf.data = banks_[i];
-            if (master->emit_notification(ntf))
-                bank_notification_mask_ &= ~(1u << i);
+    return true;
+}
+
+bool Instrument::emit_bank_notifications(size_t &budget)
+{
+    FxMaster *master = master_;
+
+    for (uint num = 0; num < 4; ++num) {
+        slotbits &pending = bank_slots_to_notify_[num];
+        const Bank &bank = *banks_[num];
+
+        for (;;) {
+            u64 any = 0;
+            for (u64 bits : pending)
+                any |= bits;
+            if (!any)
+                break;
+            if (budget < sizeof(Notification::BankSlots))
+                return false;
+
+            Notification::BankSlots ntf;
+            ntf.num = num;
+            ntf.pgm_count = bank.pgm_count;
+            slotbits sent{};
+            uint count = 0;
+            for (uint w = 0, nw = pending.size(); w < nw && count < ntf.max_count; ++w) {
+                for (u64 bits = pending[w]; bits && count < ntf.max_count; bits &= bits - 1) {
+                    uint slot = 64 * w + ctz(bits);
+                    ntf.slot[count] = slot;
+                    ntf.pgm[count] = bank.pgm[slot];
+                    sent[w] |= bits & ~(bits - 1);
+                    ++count;
+                }
+            }
+            ntf.count = count;
+
+            bool last = true;
+            for (uint w = 0, nw = pending.size(); w < nw; ++w)
+                last = last && (pending[w] & ~sent[w]) == 0;
+            ntf.last = last;
+
+            if (!master->emit_notification(ntf))
+                return false;
+            for (uint w = 0, nw = pending.size(); w < nw; ++w)
+                pending[w] &= ~sent[w];
+            budget -= sizeof(ntf);
         }
     }
+
+    return true;
 }
 
 }  // namespace cws80
@@ -1,7 +1,9 @@
 #pragma once
 #include "cws/cws80_ins_util.h"
 #include "cws/cws80_program.h"
+#include "cws/cws80_bank_pool.h"
 #include "cws/cws80_data.h"
+#include "cws/cws80_voice_budget.h"
 #include "plugin/plug_fx_master.h"
 #include "cws/component/env.h"
 #include "cws/component/lfo.h"
@@ -10,83 +12,192 @@
 #include "cws/component/sat.h"
 #include "cws/component/vcf.h"
 #include "cws/component/dca4.h"
-#include "utility/pb_alloc.h"
+#include "utility/arena.h"
+#include "utility/seqlock.h"
 #include "utility/types.h"
 #include "utility/container/bounded_vector.h"
+#include "utility/container/index_list.h"
 #include <atomic>
 #include <bitset>
+#include <tuple>
 #include <array>
 #include <memory>
 
 namespace cws80 {
 
-enum { polymax = 16 };
+enum { polymax = 128 };
+enum { max_parts = 16 };
 typedef std::bitset<polymax> polybits;
 
+// set of program parameters, as words of 64 bits
+typedef std::array<u64, (Param::num_params + 63) / 64> parambits;
+// set of program slots of a bank
+typedef std::array<u64, Bank::max_programs / 64> slotbits;
+
 typedef basic_mod_buffer<i8> mod_buffer;
-typedef std::shared_ptr<mod_buffer> mod_buffer_ptr;
+typedef basic_mod_matrix<i8> mod_matrix;
 
 //------------------------------------------------------------------------------
-class Voice {
+// a voice starts on a cache line, with the state of the components first
+//  the configuration, read once per block, comes after
+class alignas(arena::line) Voice {
 public:
     ~Voice();
-    void initialize(f64 fs, uint bs, pb_alloc<> &alloc);
+    // rows of the modulation matrix of a voice, except the controllers
+    enum { mod_rows = 13 };
+    // memory to take from the arena at initialization
+    static size_t memory_size(uint bs);
+    // working buffers of the rendering, which voices rendering in turn share
+    static size_t scratch_size(uint bs);
+    // the voice has the rows from the given one in the matrix
+    void initialize(f64 fs, uint bs, mod_matrix &mods, uint row,
+                    i16 *scratch, arena &mem);
 
     void reset();
+    void set_quality(Quality q);
     void synthesize_adding(i16 *outl, i16 *outr, uint nframes);
     void synthesize_mods(uint nframes);
     void trigger(uint key, uint vel, uint ftime);
     void release(uint vel, uint ftime);
+    // release the amplitude in the given time at most, without a click
+    void fade(uint frames);
     bool finished() const { return !env_[3].running(); }
+    bool released() const { return env_[3].released(); }
+    bool fading() const { return env_[3].fading(); }
+    // output level from the amplitude envelope, 0..3969
+    uint level() const;
+    // time to render a frame, on average (s)
+    f32 cost() const { return cost_; }
+    void account_cost(f64 secs, uint nframes);
 
     uint key() const { return key_; }
 
-    mod_buffer_ptr &mod(Mod m) { return mods_[(int)m]; }
+    mod_buffer mod(Mod m) { return mods_->row(mod_row(m)); }
+    uint mod_row(Mod m) const;
+    // take the controllers from the rows of a part, WHEEL, PEDAL and XCTRL
+    void set_controller_row(uint row) { ctl_row_ = row; }
+    // LFOs of the program which do not differ from a voice to another
+    //  as a mask of bits, if they have the settings of the given program
+    uint common_lfos(const Program &main) const;
+    // take the LFOs of the mask from the shared rows of a part
+    void set_shared_lfos(uint mask, uint row);
 
     Program &program() { return pgm_; }
     const Program &program() const { return pgm_; }
 
     void handle_aftertouch(uint vel, uint ftime);
 
+    // copy the changed parameters, and refresh the affected components
+    void update_parameters(const Program &pgm, const parambits &changed);
+
 private:
-    // O(1) memory allocator
-    pb_alloc<> *alloc_;
-    // key played on this voice
-    uint key_ = 0;
-    // initial velocity of this note
-    uint vel_ = 0;
-    // buffer size
-    uint bs_ = 0;
-    // modulation output buffers
-    mod_buffer_ptr mods_[16];
     // components
     Env env_[4];
     Lfo lfo_[3];
     Osc osc_[3];
-    Dca dca_[3];
     Sat sat_;
     Vcf vcf_;
     Dca4 dca4_;
+    Dca dca_[3];
+    // key played on this voice
+    uint key_ = 0;
+    // initial velocity of this note
+    uint vel_ = 0;
+    // time to render a frame, on average (s)
+    f32 cost_ = 0;
+    // buffer size
+    uint bs_ = 0;
+    // working buffers, of scratch_size
+    i16 *scratch_ = nullptr;
+    // modulation signals, in the matrix of the instrument
+    mod_matrix *mods_ = nullptr;
+    // first row of the voice, and first row of the controllers
+    uint mod_row_ = 0;
+    uint ctl_row_ = 0;
+    // LFOs taken from the shared rows, and the first of these rows
+    uint lfo_mask_ = 0;
+    uint lfo_row_ = 0;
     // active program on this voice
     Program pgm_;
 };
 
+//------------------------------------------------------------------------------
+// MIDI message at a frame offset within a block
+struct MidiEvent {
+    uint ftime;
+    uint len;
+    const u8 *msg;
+};
+
 //------------------------------------------------------------------------------
 class Instrument {
 public:
-    explicit Instrument(FxMaster &master);
+    // the banks are in the storage if given, which may be shared
+    explicit Instrument(FxMaster &master, BankPool::Storage *banks = nullptr);
+    ~Instrument();
+    // the voices are aligned to cache lines, which new may not respect
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr) noexcept;
+    // the memory is sized for segments of bs frames, at most max_block
+    //  longer blocks are rendered in several segments
     void initialize(f64 fs, uint bs);
+
+    // residence in RAM after an activation
+    struct Residency {
+        // bytes brought into memory
+        size_t bytes = 0;
+        // bytes locked, all of them if the system allows it
+        size_t locked = 0;
+        // duration (s)
+        f64 time = 0;
+    };
+    // bring the memory which the rendering reads into RAM, and lock it if asked
+    //  the instrument with its arena, the ROM and the tables shared by instruments
+    //  the shared tables stay locked while the process runs
+    //  not for the audio thread, it may take milliseconds
+    Residency activate(bool lock);
     void load_default_banks();
     void load_bank(uint index, const Bank &bank);
 
     enum class PressureType : bool { Channel, Key };
 
+    uint midi_channel() const { return midichan_; }
     void select_midi_channel(uint c) { midichan_ = c; }
+
+    // multitimbral: each MIDI channel plays a part, with its own program
+    //  otherwise, only part 0 plays, on the selected MIDI channel
+    //  the parts share the voices and the banks
+    bool multitimbral() const { return multitimbral_; }
+    void set_multitimbral(bool multi) { multitimbral_ = multi; }
+    // shared LFOs: the LFOs which do not reset run once for each part
+    //  the voices whose LFO has the settings of the part read it in phase
+    bool shared_lfos() const { return shared_lfos_; }
+    void set_shared_lfos(bool shared) { shared_lfos_ = shared; }
+    // select the program of a part, where part 0 has the active program
+    void select_part_program(uint part, uint banknum, uint prognum);
     void select_xctrl(uint c);
     void select_ptype(PressureType pt) { ptype_ = pt; }
 
+    // number of voices 1...polymax, beyond which notes steal voices
+    uint polyphony() const { return poly_; }
+    void set_polyphony(uint poly);
+
+    // share of the real time which voices may use, 0 for no limit
+    //  under load, voices are stolen and stopped to stay within
+    f32 voice_budget() const { return budget_.target(); }
+    void set_voice_budget(f32 target) { budget_.set_target(target); }
+    const VoiceBudget::Stats &voice_budget_stats() const { return budget_.stats(); }
+
+    // rendering quality of all voices
+    Quality quality() const { return quality_; }
+    void set_quality(Quality q);
+
     void reset();
     void synthesize(i16 *outl, i16 *outr, uint nframes);
+    // synthesize a block, with events sorted by time, of any length
+    //  the voices are split only at events which start, stop or change notes
+    void synthesize(i16 *outl, i16 *outr, uint nframes,
+                    const MidiEvent *events, uint nevents);
     void synthesize_mods(uint nframes);
 
     void receive_request(const Request::T &req);
@@ -97,48 +208,69 @@ public:
     void select_program(uint banknum, uint prognum);
     void enable_program(const Program &pgm);
 
-    // setparameter: can be invoked by UI thread {
+    // setparameter: can be invoked by any thread, without locking {
+    //  values set are applied at the start of the next block
     i32 get_parameter(uint idx) const;
     void set_parameter(uint idx, i32 val);
     void set_f32_parameter(uint idx, f32 val);  // val in 0..1
     // }
 
+    // automation: can be invoked by the audio thread, for the next block {
+    void automate_parameter(uint idx, i32 val, uint ftime);
+    // set the duration of the ramp to automated values, 0 for none
+    void set_parameter_ramp(uint idx, uint frames);
+    // }
+
     // get/set name of the active program
     void rename_program(const char *name);
     char *program_name(char namebuf[8]) const;
 
-    // find voice associated to key (in the current program)
-    uint find_voice(uint key);
-    // find voices associated to key (in any program)
-    bounded_vector<uint, polymax> find_all_voices(uint key);
-    // allocate a new voice
-    uint allocate_voice();
+    // find voice associated to key (in the current program of the part)
+    uint find_voice(uint part, uint key, uint layer);
+    // allocate a new voice for the key, free or stolen
+    //  a monophonic part takes again its voice of the same layer
+    uint allocate_voice(uint part, uint key, uint layer, bool mono);
     // make an allocated voice the first in order of recency
     void reorder_voice_first(uint vnum);
+    // the voice to give up first: releasing, quiet and expensive, or else old
+    //  if held voices are not taken, none if no voice releases; the voices
+    //  which fade are not taken, they are stopping already
+    uint select_victim(bool held = true) const;
 
     // the active program (contains user edits)
     const Program &active_program() const { return program_; }
-    const std::array<Bank, 4> &banks() const { return banks_; }
+    const Bank &bank(uint index) const { return *banks_[index]; }
 
     // the selected program (original without edits)
-    Program &selected_program() { return banks_[banknum_].pgm[prognum_]; }
     const Program &selected_program() const
     {
-        return banks_[banknum_].pgm[prognum_];
+        return banks_[banknum_]->pgm[prognum_];
     }
 
+    // banks which the user interface fills, to load them without copy
+    //  and where the instrument copies the shared banks it writes
+    BankPool &bank_pool() { return bank_pool_; }
+
     uint bank_number() const { return banknum_; }
     uint program_number() const { return prognum_; }
 
 private:
     // audio master interface
     FxMaster *master_ = nullptr;
-    // O(1) memory allocator
-    pb_alloc<> alloc_;
-    // size of the memory area of the O(1) allocator (# of buffers)
-    static constexpr size_t allocatable_buffers = 16;
+    // memory of the voices and the buffers, taken at initialization
+    arena mem_;
+    // modulation signals of the voices, then the controllers of the parts
+    mod_matrix mods_;
+    // working buffers of the voices
+    i16 *scratch_ = nullptr;
+    // whether the instrument and its arena are locked in memory
+    bool locked_ = false;
     // sample rate
     f64 fs_ = 44100;
+    // longest segment which the voices render at once
+    uint bs_ = 0;
+    // most frames in a segment, which bounds the size of the arena
+    static constexpr uint max_block = 512;
     // polyphony 1...polymax
     uint poly_ = 8;
     // MIDI channel 0..15, or >15 = all
@@ -149,54 +281,166 @@ private:
     uint xctrl_ = 2;
     // Pressure type
     PressureType ptype_ = PressureType::Key;
+    // Rendering quality
+    Quality quality_ = Quality::Normal;
 
-    // output buffer of the wheel modulator
-    mod_buffer_ptr mb_wheel_;
-    // output buffer of the pedal modulator
-    mod_buffer_ptr mb_pedal_;
-    // output buffer of the xctrl modulator
-    mod_buffer_ptr mb_xctrl_;
+    // part of the instrument, which plays on a MIDI channel
+    struct Part {
+        // bank number 0-3 and program number 0-127, except for part 0
+        uint banknum = 0;
+        uint prognum = 0;
+        // changes with the program, so notes do not take voices of another
+        u32 serial = 0;
+        // LFOs shared by the voices, running when a voice reads them
+        Lfo lfos[3];
+    };
+    // parts, where part 0 plays the active program
+    std::array<Part, max_parts> parts_;
+    // first row of the controllers of a part, after the rows of the voices
+    static uint controller_row(uint part) { return polymax * Voice::mod_rows + part * 3; }
+    // output of a controller of a part, WHEEL, PEDAL or XCTRL
+    mod_buffer controller(uint part, Mod m)
+    {
+        return mods_.row(controller_row(part) + (uint)m - (uint)Mod::WHEEL);
+    }
+    // first row of the shared LFOs of a part, after the rows of the controllers
+    static uint lfo_row(uint part) { return controller_row(max_parts) + part * 3; }
+    // whether the LFOs which do not reset are shared
+    bool shared_lfos_ = false;
+    // whether each MIDI channel plays its part
+    bool multitimbral_ = false;
 
     // active program
     Program program_;
-    // whether the bank should be transmitted to the host
-    std::atomic<uint> bank_notification_mask_{(1 << 4) - 1};
+    // program slots of each bank which should be transmitted to the host
+    std::array<slotbits, 4> bank_slots_to_notify_{};
     // whether the program should be transmitted to the host
     std::atomic<bool> should_notify_program_{true};
+    // parameters of the active program which should be transmitted to the host
+    parambits parameters_to_notify_{};
+    // whether the active program changed since the last snapshot
+    bool program_changed_ = true;
     // whether a successful write should be notified
     bool should_notify_write_ = false;
+    // copy of the active program, readable by any thread
+    seqlock<Program> program_snapshot_;
+    // parameter values set by other threads, valid if dirty
+    std::array<std::atomic<i32>, Param::num_params> parameter_slots_{};
+    // parameters set by other threads, not yet applied
+    std::array<std::atomic<u64>, std::tuple_size<parambits>::value> parameter_dirty_{};
+    // parameters of the active program changed since voices were updated
+    parambits program_dirty_{};
 
     // voices
     std::array<Voice, polymax> voices_;
-    // active voices in order (most recent first)
-    bounded_vector<u8, polymax> vcorder_;
-    // whether a voice is currently allocated
-    polybits vcallocd_;
+    // allocated voices in order (most recent first), and free voices
+    enum { active_voices, free_voices };
+    index_lists<polymax, 2> vclists_;
+    // allocated voices of each key (most recent first)
+    index_lists<polymax, 128> vckeys_;
     // whether a voice plays another program than the instrument
     polybits vcforeign_;
+    // part of each voice
+    std::array<u8, polymax> vcpart_{};
+    // layer of each voice, 0 for the main or split program, 1 for its layer
+    std::array<u8, polymax> vclayer_{};
+    // program serial of the part, when the voice started
+    std::array<u32, polymax> vcserial_{};
+    // limit of voices under load
+    VoiceBudget budget_;
+    // time in which a held voice over the limit fades out (s)
+    static constexpr f64 shed_fade_time = 5e-3;
 
-    // bank memory
-    std::array<Bank, 4> banks_{};
+    // automation of a parameter at a frame offset
+    struct Automation {
+        uint ftime;
+        uint index;
+        i32 value;
+    };
+    // progressive change of a parameter
+    struct Ramp {
+        f32 value;
+        f32 step;
+        i32 target;
+        uint remain;
+    };
+    // automation queued for the next block, at most one per parameter
+    bounded_vector<Automation, Param::num_params> automation_;
+    // position of each parameter in the automation queue, or 0xff
+    std::array<u8, Param::num_params> automation_slot_;
+    // duration of the ramp of each parameter
+    std::array<uint, Param::num_params> ramp_frames_{};
+    // ramps of the parameters, valid when running
+    std::array<Ramp, Param::num_params> ramps_{};
+    // parameters with a running ramp
+    bounded_vector<u8, Param::num_params> ramping_;
+    // frame offset where the ramps are, in the current block
+    uint ramp_time_ = 0;
+    // longest segment while ramps are running
+    static constexpr uint ramp_segment = 64;
+    // most bytes of notifications in a block
+    static constexpr size_t notification_budget = 2048;
+
+    // bank memory, from the pool
+    BankPool bank_pool_;
+    // banks, shared between instruments until written
+    std::array<const Bank *, 4> banks_{};
+    // banks of the pool, written or loaded, otherwise null
+    std::array<Bank *, 4> own_banks_{};
+    // shared banks, immutable, otherwise null
+    std::array<std::shared_ptr<const Bank>, 4> shared_banks_;
     // bank number 0-3
     uint banknum_ = 0;
     // program number 0-127
     uint prognum_ = 0;
 
-private:
-    static void initialize_tables();
-
 private:
     void emit_notifications();
+    // send the changed parameters, and the changed programs of banks
+    bool emit_parameter_notifications(size_t &budget);
+    bool emit_bank_notifications(size_t &budget);
+    // record a change of programs in a bank, to notify
+    void mark_bank_changed(uint num);
+    void mark_bank_slot_changed(uint num, uint slot);
+    // install a bank of the pool, or a shared bank
+    //  a bank of the pool which it replaces returns to the pool
+    void set_bank(uint num, Bank *own, std::shared_ptr<const Bank> shared);
+    // the bank to modify, copied from the shared bank the first time
+    //  null if the pool has no bank left
+    Bank *writable_bank(uint num);
+    // render a segment, where the events are already received
+    void render(i16 *outl, i16 *outr, uint nframes);
+    // set a parameter of the active program
+    void apply_parameter(uint idx, i32 val);
+    // record a change of the active program, to notify and to update voices
+    void mark_parameter_changed(uint idx);
+    // push the changed parameters to the voices playing the active program
+    void update_voice_parameters();
+    // queue the parameters which were set by other threads
+    void collect_parameters();
+    // apply automation and ramps up to the frame offset, included
+    void run_automation(uint ftime, uint &index);
+    void advance_ramps(uint ftime);
+    void clear_automation();
+    // the program of a part, and the bank where it is
+    const Program &part_program(uint part) const;
+    const Bank &part_bank(uint part) const;
+    // programs which a key plays on a part, the main or split one, and a layer
+    uint key_programs(uint part, uint key, const Program *pgms[2]) const;
     // MIDI message handling
-    void handle_noteoff(uint key, uint vel, uint ftime);
-    void handle_noteon(uint key, uint vel, uint ftime);
-    void handle_aftertouch(uint key, uint vel, uint ftime);
-    void handle_cc(uint ctl, uint val, uint ftime);
-    void handle_progchange(uint num, uint ftime);
-    void handle_aftertouch(uint vel, uint ftime);
-    void handle_pitchbend(uint bend, uint ftime);
+    void handle_noteoff(uint part, uint key, uint vel, uint ftime);
+    void handle_noteon(uint part, uint key, uint vel, uint ftime);
+    void handle_aftertouch(uint part, uint key, uint vel, uint ftime);
+    void handle_cc(uint part, uint ctl, uint val, uint ftime);
+    void handle_progchange(uint part, uint num, uint ftime);
+    void handle_aftertouch(uint part, uint vel, uint ftime);
+    void handle_pitchbend(uint part, uint bend, uint ftime);
     // Voice management
     void shutdown_idle_voices();
+    void stop_voice(uint vnum);
+    // fade out the voices over the limit of the budget, the releasing ones
+    //  first, and stop at once only those which are silent already
+    void shed_voices();
 };
 
 }  // namespace cws80
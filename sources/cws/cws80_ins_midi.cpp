@@ -28,7 +28,10 @@ void Instrument::receive_midi(const u8 *msg, uint len, uint ftime)
 
     // channel message
     uint chan = status & 15;
-    if (midichan_ < 16 && chan != midichan_)
+    uint part = 0;
+    if (multitimbral_)
+        part = chan;
+    else if (midichan_ < 16 && chan != midichan_)
         return;
 
     data1 &= 127;
@@ -41,25 +44,25 @@ void Instrument::receive_midi(const u8 *msg, uint len, uint ftime)
 
     switch (event) {
     case 0b1000:
-        handle_noteoff(data1, data2, ftime);
+        handle_noteoff(part, data1, data2, ftime);
         break;
     case 0b1001:
-        handle_noteon(data1, data2, ftime);
+        handle_noteon(part, data1, data2, ftime);
         break;
     case 0b1010:
-        handle_aftertouch(data1, data2, ftime);
+        handle_aftertouch(part, data1, data2, ftime);
         break;
     case 0b1011:
-        handle_cc(data1, data2, ftime);
+        handle_cc(part, data1, data2, ftime);
         break;
     case 0b1100:
-        handle_progchange(data1, ftime);
+        handle_progchange(part, data1, ftime);
         break;
     case 0b1101:
-        handle_aftertouch(data1, ftime);
+        handle_aftertouch(part, data1, ftime);
         break;
     case 0b1110:
-        handle_pitchbend(data1 | (data2 << 7), ftime);
+        handle_pitchbend(part, data1 | (data2 << 7), ftime);
         break;
     }
 }
@@ -78,65 +81,81 @@ void Instrument::receive_sysex(const u8 *msg, uint len, uint ftime)
 #define trace_midi(...)
 // #define trace_midi(fmt, ...) do fprintf(stderr, "[midi] " fmt "\n", ##__VA_ARGS__); while (0)
 
-void Instrument::handle_noteoff(uint key, uint vel, uint ftime)
+void Instrument::handle_noteoff(uint part, uint key, uint vel, uint ftime)
 {
-    trace_midi("note-off key=%u vel=%u", key, vel);
+    trace_midi("note-off part=%u key=%u vel=%u", part, key, vel);
 
-    for (uint vnum : find_all_voices(key)) {
+    for (uint vnum : vckeys_.range(key)) {
         Voice &vc = voices_[vnum];
-        vc.release(vel, ftime);
+        if (vcpart_[vnum] == part)
+            vc.release(vel, ftime);
     }
 }
 
-void Instrument::handle_noteon(uint key, uint vel, uint ftime)
+void Instrument::handle_noteon(uint part, uint key, uint vel, uint ftime)
 {
-    trace_midi("note-on key=%u vel=%u", key, vel);
-
-    uint vnum = find_voice(key);
-    if (vnum != ~0u) {
-        Voice &vc = voices_[vnum];
-        reorder_voice_first(vnum);
-        vc.trigger(key, vel, ftime);
-    }
-    else if ((vnum = allocate_voice()) != ~0u) {
-        Voice &vc = voices_[vnum];
-        vcforeign_[vnum] = false;
-        vc.program() = program_;
-        vc.reset();
-        vc.trigger(key, vel, ftime);
+    trace_midi("note-on part=%u key=%u vel=%u", part, key, vel);
+
+    const Program *pgms[2];
+    uint count = key_programs(part, key, pgms);
+
+    for (uint layer = 0; layer < count; ++layer) {
+        const Program &pgm = *pgms[layer];
+        uint vnum = find_voice(part, key, layer);
+        if (vnum != ~0u) {
+            Voice &vc = voices_[vnum];
+            reorder_voice_first(vnum);
+            vc.trigger(key, vel, ftime);
+        }
+        else if ((vnum = allocate_voice(part, key, layer, pgm.misc.MONO)) != ~0u) {
+            Voice &vc = voices_[vnum];
+            const Part &pt = parts_[part];
+            // only the active program receives edits
+            vcforeign_[vnum] = &pgm != &program_;
+            vcpart_[vnum] = part;
+            vclayer_[vnum] = layer;
+            vcserial_[vnum] = pt.serial;
+            vc.set_controller_row(controller_row(part));
+            vc.program() = pgm;
+            vc.reset();
+            vc.trigger(key, vel, ftime);
+        }
     }
 }
 
-void Instrument::handle_aftertouch(uint key, uint vel, uint ftime)
+void Instrument::handle_aftertouch(uint part, uint key, uint vel, uint ftime)
 {
-    trace_midi("aftertouch key=%u vel=%u", key, vel);
+    trace_midi("aftertouch part=%u key=%u vel=%u", part, key, vel);
 
     if (ptype_ == PressureType::Key) {
-        uint vnum = find_voice(key);
-        if (vnum != ~0u)
-            voices_[vnum].handle_aftertouch(vel, ftime);
+        for (uint vnum : vckeys_.range(key)) {
+            if (vcpart_[vnum] == part && vcserial_[vnum] == parts_[part].serial)
+                voices_[vnum].handle_aftertouch(vel, ftime);
+        }
     }
 }
 
-void Instrument::handle_cc(uint ctl, uint val, uint ftime)
+void Instrument::handle_cc(uint part, uint ctl, uint val, uint ftime)
 {
-    trace_midi("control-change key=%u vel=%u", ctl, val);
+    trace_midi("control-change part=%u key=%u vel=%u", part, ctl, val);
 
     if (ctl == xctrl_)
-        mb_xctrl_->append(ftime, val / 2);
+        controller(part, Mod::XCTRL).append(ftime, val / 2);
 
     switch (ctl) {
     case 1:  // modulation wheel
-        mb_wheel_->append(ftime, val / 2);
+        controller(part, Mod::WHEEL).append(ftime, val / 2);
         break;
     case 4:  // foot controller
-        mb_pedal_->append(ftime, val / 2);
+        controller(part, Mod::PEDAL).append(ftime, val / 2);
         break;
 
     case 6:  // Data entry
+        if (part != 0)
+            break;  // only the active program is edited
         if (nrpn_ < 128) {
             if (program_.apply_nrpn(nrpn_, val))
-                should_notify_program_ = true;
+                mark_parameter_changed(Program::nrpn_parameter(nrpn_));
         }
         else {
             uint rpn = nrpn_ - 128;
@@ -145,11 +164,13 @@ void Instrument::handle_cc(uint ctl, uint val, uint ftime)
         break;
 
     case 98:  // NRPN LSB
-        nrpn_ = val;
+        if (part == 0)
+            nrpn_ = val;
         break;
 
     case 100:  // RPN LSB
-        nrpn_ = 128 + val;
+        if (part == 0)
+            nrpn_ = 128 + val;
         break;
 
     // channel mode controls
@@ -170,28 +191,34 @@ void Instrument::handle_cc(uint ctl, uint val, uint ftime)
     }
 }
 
-void Instrument::handle_progchange(uint num, uint ftime)
+void Instrument::handle_progchange(uint part, uint num, uint ftime)
 {
     (void)ftime;
 
-    trace_midi("program-change num=%u", num);
-    select_program(banknum_, num);
+    trace_midi("program-change part=%u num=%u", part, num);
+    if (part == 0)
+        select_program(banknum_, num);
+    else
+        select_part_program(part, parts_[part].banknum, num);
 }
 
-void Instrument::handle_aftertouch(uint vel, uint ftime)
+void Instrument::handle_aftertouch(uint part, uint vel, uint ftime)
 {
-    trace_midi("aftertouch vel=%u", vel);
+    trace_midi("aftertouch part=%u vel=%u", part, vel);
     if (ptype_ == PressureType::Channel) {
-        for (uint vnum : vcorder_)
-            voices_[vnum].handle_aftertouch(vel, ftime);
+        for (uint vnum : vclists_.range(active_voices)) {
+            if (vcpart_[vnum] == part)
+                voices_[vnum].handle_aftertouch(vel, ftime);
+        }
     }
 }
 
-void Instrument::handle_pitchbend(uint bend, uint ftime)
+void Instrument::handle_pitchbend(uint part, uint bend, uint ftime)
 {
+    (void)part;
     (void)ftime;
 
-    trace_midi("pitchbend bend=%d", bend);
+    trace_midi("pitchbend part=%u bend=%d", part, bend);
 
 #pragma message("TODO: pitch bend")
     (void)bend;
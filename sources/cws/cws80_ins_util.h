@@ -1,78 +1,141 @@
 #pragma once
+#include "utility/arena.h"
 #include "utility/types.h"
-#include <memory>
 #include <algorithm>
+#include <assert.h>
 
 namespace cws80 {
 
+// a row of the modulation matrix, which the voices fill when needed
 template <class T> class basic_mod_buffer {
-    std::unique_ptr<T[]> buf_;
-    uint fli_ = 0;
+    T *buf_ = nullptr;
+    uint *fli_ = nullptr;
 
 public:
     basic_mod_buffer() {}
 
-    // set the capacity of the buffer
-    explicit basic_mod_buffer(uint size) { buf_.reset(new T[size]()); }
+    // the frames of the row, and its fill index
+    basic_mod_buffer(T *buf, uint *fli) : buf_(buf), fli_(fli) {}
 
     // reinitialize the buffer
     void clear(const T &val = {})
     {
         buf_[0] = val;
-        fli_ = 0;
+        *fli_ = 0;
     }
 
     // make the buffer's last element the first and reset the fill index
     void cycle()
     {
-        T *buf = buf_.get();
-        uint fli = fli_;
+        T *buf = buf_;
+        uint fli = *fli_;
         buf[0] = buf[fli];
-        fli_ = 0;
+        *fli_ = 0;
     }
 
     // fill the buffer with its last value up to pos included,
     //  and update the fill index
     void repeat_upto(uint pos)
     {
-        T *buf = buf_.get();
-        uint fli = fli_;
-        std::fill(buf + fli, buf + pos + 1, buf[fli]);
-        fli_ = pos;
+        T *buf = buf_;
+        uint fli = *fli_;
+        // the previous fill may have gone past pos, if the block shrinks
+        if (fli < pos)
+            std::fill(buf + fli + 1, buf + pos + 1, buf[fli]);
+        *fli_ = pos;
     }
 
     // fill the entire buffer with the given value, and update the fill index
     void fill_entire(const T &val, uint size)
     {
-        T *buf = buf_.get();
+        T *buf = buf_;
         std::fill(buf, buf + size, val);
-        fli_ = size - 1;
+        *fli_ = size - 1;
     }
 
     // fill the buffer with its last value up to pos, assign value to pos,
     //  and update the fill index
     void append(uint pos, const T &val)
     {
-        T *buf = buf_.get();
-        uint fli = fli_;
+        T *buf = buf_;
+        uint fli = *fli_;
         std::fill(buf + fli, buf + pos, buf[fli]);
         buf[pos] = val;
-        fli_ = pos;
+        *fli_ = pos;
     }
 
     //
     const T *for_input(uint size)
     {
         repeat_upto(size - 1);
-        return buf_.get();
+        return buf_;
     }
 
     //
     T *for_output(uint size)
     {
-        fli_ = size - 1;
-        return buf_.get();
+        *fli_ = size - 1;
+        return buf_;
     }
 };
 
+//------------------------------------------------------------------------------
+// modulation signals of an instrument, one row of frames per signal
+//  the rows are contiguous, with a fixed stride of whole cache lines
+template <class T> class basic_mod_matrix {
+public:
+    // memory to take from the arena at initialization
+    static size_t memory_size(uint rows, uint bs)
+    {
+        return arena::footprint(rows * stride_for(bs) * sizeof(T)) +
+               arena::footprint(rows * sizeof(uint));
+    }
+
+    void initialize(uint rows, uint bs, arena &mem)
+    {
+        stride_ = stride_for(bs);
+        rows_ = rows;
+        data_ = mem.allocate_array<T>(rows * stride_);
+        fill_ = mem.allocate_array<uint>(rows);
+    }
+
+    uint rows() const { return rows_; }
+    uint stride() const { return stride_; }
+
+    basic_mod_buffer<T> row(uint r)
+    {
+        assert(r < rows_);
+        return basic_mod_buffer<T>(data_ + r * stride_, fill_ + r);
+    }
+
+private:
+    static uint stride_for(uint bs)
+    {
+        return arena::footprint(bs * sizeof(T)) / sizeof(T);
+    }
+
+private:
+    T *data_ = nullptr;
+    uint *fill_ = nullptr;
+    uint rows_ = 0;
+    uint stride_ = 0;
+};
+
+//------------------------------------------------------------------------------
+// whether a MIDI message changes the notes, as opposed to the controllers
+inline bool midi_splits_block(const u8 *msg, uint len)
+{
+    if (len == 0)
+        return false;
+    switch (msg[0] >> 4) {
+    case 0b1000:  // note off
+    case 0b1001:  // note on
+    case 0b1100:  // program change
+    case 0b1111:  // system
+        return true;
+    default:
+        return false;
+    }
+}
+
 }  // namespace cws80
@@ -1,4 +1,5 @@
 #include "cws80_ins.h"
+#include <algorithm>
 #include <stdio.h>
 
 namespace cws80 {
@@ -6,13 +7,11 @@ namespace cws80 {
 #define trace_vcm(...)
 // #define trace_vcm(fmt, ...) do fprintf(stderr, "[vcm] " fmt "\n", ##__VA_ARGS__); while (0)
 
-uint Instrument::find_voice(uint key)
+uint Instrument::find_voice(uint part, uint key, uint layer)
 {
-    for (uint vnum : vcorder_) {
-        Voice &vc = voices_[vnum];
-        bool allocd = vcallocd_[vnum];
-        bool foreign = vcforeign_[vnum];
-        if (vc.key() == key && allocd && !foreign) {
+    u32 serial = parts_[part].serial;
+    for (uint vnum : vckeys_.range(key)) {
+        if (vcpart_[vnum] == part && vclayer_[vnum] == layer && vcserial_[vnum] == serial) {
             trace_vcm("voice %u found for key %u", vnum, key);
             return vnum;
         }
@@ -21,43 +20,37 @@ uint Instrument::find_voice(uint key)
     return ~0u;
 }
 
-bounded_vector<uint, polymax> Instrument::find_all_voices(uint key)
+uint Instrument::allocate_voice(uint part, uint key, uint layer, bool mono)
 {
-    bounded_vector<uint, polymax> all;
-    for (uint vnum : vcorder_) {
-        Voice &vc = voices_[vnum];
-        bool allocd = vcallocd_[vnum];
-        if (vc.key() == key && allocd)
-            all.push_back(vnum);
-    }
-    return all;
-}
-
-uint Instrument::allocate_voice()
-{
-    const Program &pgm = program_;
     uint vnum = ~0u;
-    uint poly = pgm.misc.MONO ? 1 : poly_;
-    uint count = 0;
+    uint poly = std::min(poly_, budget_.limit());
     const bool steal = true;
 
-    for (uint p = 0; p < polymax && vnum == ~0u && count < poly; ++p) {
-        bool allocd = vcallocd_[p];
-        // bool foreign = vcforeign_[p];
-        count += allocd /* && !foreign */;
-        vnum = allocd ? ~0u : p;
+    if (mono) {
+        for (uint other : vclists_.range(active_voices)) {
+            if (vcpart_[other] == part && vclayer_[other] == layer) {
+                vnum = other;
+                break;
+            }
+        }
     }
 
     if (vnum != ~0u) {
+        trace_vcm("take again voice %u", vnum);
+    }
+    else if (vclists_.size(active_voices) < poly) {
+        vnum = vclists_.front(free_voices);
         trace_vcm("allocate voice %u", vnum);
-        vcallocd_[vnum] = true;
-        vcorder_.insert(vcorder_.begin(), (u8)vnum);
     }
-    else if (steal && !vcorder_.empty()) {
-        vnum = vcorder_.back();
+    else if (steal && !vclists_.empty(active_voices)) {
+        vnum = select_victim();
         trace_vcm("steal voice %u", vnum);
-        vcorder_.pop_back();
-        vcorder_.insert(vcorder_.begin(), (u8)vnum);
+        budget_.stats().steals.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (vnum != ~0u) {
+        vclists_.push_front(active_voices, vnum);
+        vckeys_.push_front(key, vnum);
     }
 
     return vnum;
@@ -65,28 +58,89 @@ uint Instrument::allocate_voice()
 
 void Instrument::reorder_voice_first(uint vnum)
 {
-    bounded_vector<u8, polymax> orig = vcorder_;
-    vcorder_.clear();
-    vcorder_.push_back(vnum);
-    for (uint other : orig) {
-        if (vnum != other)
-            vcorder_.push_back(other);
+    vclists_.push_front(active_voices, vnum);
+    vckeys_.push_front(voices_[vnum].key(), vnum);
+}
+
+uint Instrument::select_victim(bool held) const
+{
+    uint victim = ~0u;
+    f32 best = 0;
+
+    // from the least recent, which wins in case of equality
+    for (uint vnum = vclists_.back(active_voices); vnum != vclists_.none;
+         vnum = vclists_.prev(vnum)) {
+        const Voice &vc = voices_[vnum];
+        if (!vc.released() || (!held && vc.fading()))
+            continue;
+        // audible level per unit of cost, lowest first
+        f32 score = (vc.level() + 1) / (vc.cost() + 1e-9f);
+        if (victim == ~0u || score < best) {
+            victim = vnum;
+            best = score;
+        }
     }
+
+    if (victim == ~0u && held)
+        victim = vclists_.back(active_voices);
+    return victim;
 }
 
-void Instrument::shutdown_idle_voices()
+void Instrument::stop_voice(uint vnum)
 {
-    bounded_vector<u8, polymax> orig = vcorder_;
-    vcorder_.clear();
-    for (uint vnum : orig) {
+    trace_vcm("stop voice %u", vnum);
+    voices_[vnum].reset();
+    vckeys_.erase(vnum);
+    vclists_.push_front(free_voices, vnum);
+}
+
+void Instrument::shed_voices()
+{
+    uint limit = budget_.limit();
+    uint frames = (uint)(fs_ * shed_fade_time);
+
+    // the voices which fade are stopping already
+    uint count = 0;
+    for (uint vnum : vclists_.range(active_voices))
+        count += !voices_[vnum].fading();
+
+    // a voice is not cut while audible, it fades out, even in its release
+    auto shed = [this, frames](uint vnum) {
         Voice &vc = voices_[vnum];
-        if (!vc.finished()) {
-            vcorder_.push_back(vnum);
-        }
+        if (vc.level() == 0)
+            stop_voice(vnum);
         else {
+            trace_vcm("fade voice %u", vnum);
+            vc.fade(frames);
+        }
+        budget_.stats().sheds.fetch_add(1, std::memory_order_relaxed);
+    };
+
+    // the releasing voices first, then the least recent held ones
+    for (uint vnum; count > limit && (vnum = select_victim(false)) != ~0u; --count)
+        shed(vnum);
+    for (uint vnum = vclists_.back(active_voices); count > limit && vnum != vclists_.none;) {
+        uint prev = vclists_.prev(vnum);
+        if (!voices_[vnum].released()) {
+            shed(vnum);
+            --count;
+        }
+        vnum = prev;
+    }
+}
+
+void Instrument::shutdown_idle_voices()
+{
+    for (uint vnum = vclists_.front(active_voices); vnum != vclists_.none;) {
+        uint next = vclists_.next(vnum);
+        Voice &vc = voices_[vnum];
+        if (vc.finished()) {
             trace_vcm("shutdown voice %u", vnum);
-            vcallocd_[vnum] = false;
+            vckeys_.erase(vnum);
+            // the next allocation reuses the voice which was last in cache
+            vclists_.push_front(free_voices, vnum);
         }
+        vnum = next;
     }
 }
 
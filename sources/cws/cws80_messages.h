@@ -1,6 +1,7 @@
 #pragma once
 #include "cws/cws80_program.h"
 #include "utility/types.h"
+#include <chrono>
 #include <assert.h>
 
 namespace cws80 {
@@ -9,7 +10,7 @@ static constexpr char CWS80__Notification[] = "urn:jpcima:cws80#Notification";
 static constexpr char CWS80__Request[] = "urn:jpcima:cws80#Request";
 
 //------------------------------------------------------------------------------
-#define EACH_NOTIFICATION_TYPE(F) F(Bank) F(Program) F(Write)
+#define EACH_NOTIFICATION_TYPE(F) F(BankSlots) F(Program) F(Parameters) F(Write)
 
 enum class NotificationType {
 #define EACH(x) x,
@@ -23,12 +24,20 @@ namespace Notification {
         NotificationType type{};
     };
 
-    struct Bank : T {
-        Bank() { type = NotificationType::Bank; }
-        u32 num;
-        cws80::Bank data;
+    // programs of a bank which changed, in order of slot
+    struct BankSlots : T {
+        BankSlots() { type = NotificationType::BankSlots; }
+        enum { max_count = 8 };
+        u8 num;
+        u8 pgm_count;
+        u8 count;
+        // whether all changes of the bank are sent
+        bool last;
+        u8 slot[max_count];
+        cws80::Program pgm[max_count];
     };
 
+    // the active program, after a change of selection or a rename
     struct Program : T {
         Program() { type = NotificationType::Program; }
         u32 bank;
@@ -36,6 +45,15 @@ namespace Notification {
         cws80::Program data;
     };
 
+    // parameters of the active program which changed
+    struct Parameters : T {
+        Parameters() { type = NotificationType::Parameters; }
+        enum { max_count = 8 };
+        u8 count;
+        u8 index[max_count];
+        i16 value[max_count];
+    };
+
     struct Write : T {
         Write() { type = NotificationType::Write; }
     };
@@ -84,7 +102,9 @@ namespace Request {
 
     struct LoadBank : T {
         LoadBank() { type = RequestType::LoadBank; }
-        Bank data;
+        // index of a bank acquired from the bank pool of the instrument,
+        //  filled up to 128 programs, and owned by the instrument once received
+        u32 index;
     };
 
     struct RenameProgram : T {
@@ -115,12 +135,16 @@ namespace Request {
         NoteOn() { type = RequestType::NoteOn; }
         u8 key;
         u8 velocity;
+        // steady clock of the sender in ns, 0 if unknown
+        u64 time = 0;
     };
 
     struct NoteOff : T {
         NoteOff() { type = RequestType::NoteOff; }
         u8 key;
         u8 velocity;
+        // steady clock of the sender in ns, 0 if unknown
+        u64 time = 0;
     };
 
 }  // namespace Request
@@ -137,6 +161,14 @@ struct RequestTraits {
     static void free(const Request::T *req);
 };
 
+// time of the steady clock in ns, which timestamps the requests
+inline u64 request_time()
+{
+    namespace stc = std::chrono;
+    stc::steady_clock::duration d = stc::steady_clock::now().time_since_epoch();
+    return stc::duration_cast<stc::nanoseconds>(d).count();
+}
+
 //------------------------------------------------------------------------------
 constexpr size_t NotificationTraits::size() const
 {
@@ -97,11 +97,15 @@ struct Program {
     static const char *get_parameter_name(uint idx);
     static const char *get_parameter_short_name(uint idx);
     static i32 clamp_parameter_value(uint idx, i32 val);
+    // whether the parameter is a quantity which can change progressively
+    static bool is_parameter_continuous(uint idx);
 
     bool set_u7_parameter(uint idx, int val7);  // val in 0..127
     bool set_f32_parameter(uint idx, f32 valf);  // val in 0..1
 
     bool apply_nrpn(int nrpn, int val7);
+    // parameter addressed by a NRPN, or ~0u
+    static uint nrpn_parameter(int nrpn);
 };
 #pragma pack(pop)
 
@@ -91,6 +91,38 @@ i32 Program::clamp_parameter_value(uint idx, i32 val)
     return clamp(val, range.first, range.second);
 }
 
+bool Program::is_parameter_continuous(uint idx)
+{
+    if (idx < Param::first_lfo_param) {
+        uint p = (idx - Param::first_env_param) % Param::env_params;
+        // all except the switches
+        return p != P_Env1_LE && p != P_Env1_R2;
+    }
+    if (idx < Param::first_osc_param) {
+        uint p = (idx - Param::first_lfo_param) % Param::lfo_params + Param::first_lfo_param;
+        return p == P_Lfo1_FREQ || p == P_Lfo1_L1 || p == P_Lfo1_L2 || p == P_Lfo1_DELAY;
+    }
+    if (idx < Param::first_misc_param) {
+        uint p = (idx - Param::first_osc_param) % Param::osc_params + Param::first_osc_param;
+        return p == P_Osc1_FINE || p == P_Osc1_FCMODAMT1 || p == P_Osc1_FCMODAMT2 ||
+               p == P_Osc1_DCALEVEL || p == P_Osc1_AMAMT1 || p == P_Osc1_AMAMT2;
+    }
+    switch (idx) {
+    case P_Misc_DCA4MODAMT:
+    case P_Misc_FLTFC:
+    case P_Misc_Q:
+    case P_Misc_FCMODAMT1:
+    case P_Misc_FCMODAMT2:
+    case P_Misc_KEYBD:
+    case P_Misc_GLIDE:
+    case P_Misc_PAN:
+    case P_Misc_PANMODAMT:
+        return true;
+    default:
+        return false;
+    }
+}
+
 bool Program::set_u7_parameter(uint idx, int val7)
 {
     std::pair<i32, i32> range = get_parameter_range(idx);
@@ -108,6 +140,15 @@ bool Program::set_f32_parameter(uint idx, f32 valf)
 }
 
 bool Program::apply_nrpn(int nrpn, int val7)
+{
+    uint idx7 = nrpn_parameter(nrpn);
+    if (idx7 == ~0u)
+        return false;
+
+    return set_u7_parameter(idx7, val7);
+}
+
+uint Program::nrpn_parameter(int nrpn)
 {
     uint idx7 = ~0u;
 
@@ -313,10 +354,7 @@ bool Program::apply_nrpn(int nrpn, int val7)
         break;
     }
 
-    if (idx7 == ~0u)
-        return false;
-
-    return set_u7_parameter(idx7, val7);
+    return idx7;
 }
 
 }  // namespace cws80
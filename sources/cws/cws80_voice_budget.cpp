@@ -0,0 +1,72 @@
+#include "cws80_voice_budget.h"
+#include <algorithm>
+
+namespace cws80 {
+
+void VoiceBudget::initialize(f64 fs)
+{
+    fs_ = fs;
+    voice_cost_ = 0;
+    block_secs_ = 0;
+    block_frames_ = 0;
+    block_voice_frames_ = 0;
+    limit_ = ~0u;
+    stats_.limit.store(limit_, std::memory_order_relaxed);
+}
+
+void VoiceBudget::set_target(f32 target)
+{
+    target_ = std::max(0.0f, target);
+    if (target_ == 0) {
+        limit_ = ~0u;
+        stats_.limit.store(limit_, std::memory_order_relaxed);
+    }
+}
+
+void VoiceBudget::account(f64 secs, uint nframes, uint nvoices)
+{
+    block_secs_ += secs;
+    block_frames_ += nframes;
+    block_voice_frames_ += (u64)nframes * nvoices;
+}
+
+void VoiceBudget::end_block(uint poly)
+{
+    f64 secs = block_secs_;
+    u64 frames = block_frames_;
+    u64 voice_frames = block_voice_frames_;
+    block_secs_ = 0;
+    block_frames_ = 0;
+    block_voice_frames_ = 0;
+
+    if (!enabled() || frames == 0)
+        return;
+
+    Stats &stats = stats_;
+    if (secs * fs_ > frames)
+        stats.overruns.fetch_add(1, std::memory_order_relaxed);
+
+    if (voice_frames > 0) {
+        f64 cost = secs / voice_frames;
+        if (voice_cost_ == 0)
+            voice_cost_ = cost;
+        else {
+            // a preempted block counts at most for twice the average
+            cost = std::min(cost, 2 * voice_cost_);
+            voice_cost_ += (cost - voice_cost_) * (1.0 / 16);
+        }
+    }
+
+    uint limit = ~0u;
+    if (voice_cost_ > 0) {
+        f64 voices = target_ / (voice_cost_ * fs_);
+        limit = (uint)std::max(1.0, std::min(voices, (f64)~0u));
+    }
+
+    limit_ = limit;
+    stats.limit.store(limit, std::memory_order_relaxed);
+    if (limit < poly)
+        stats.limited.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace cws80
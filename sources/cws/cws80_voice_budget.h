@@ -0,0 +1,61 @@
+#pragma once
+#include "utility/types.h"
+#include <atomic>
+
+namespace cws80 {
+
+//------------------------------------------------------------------------------
+// limit of the number of voices, which keeps their rendering within a share
+//  of the real time. it follows the cost of a voice measured in recent blocks.
+class VoiceBudget {
+public:
+    // counters of the interventions, readable by any thread
+    struct Stats {
+        // voices taken by new notes, past the polyphony or the limit
+        std::atomic<u64> steals{0};
+        // voices stopped because the limit was lowered
+        std::atomic<u64> sheds{0};
+        // blocks where the limit was under the polyphony
+        std::atomic<u64> limited{0};
+        // blocks where the voices took longer than the block duration
+        std::atomic<u64> overruns{0};
+        // current limit
+        std::atomic<u32> limit{~0u};
+    };
+
+    void initialize(f64 fs);
+
+    // share of the real time which voices may use, 0 for no limit
+    f32 target() const { return target_; }
+    void set_target(f32 target);
+    bool enabled() const { return target_ > 0; }
+
+    // account the time to render a segment, with the given number of voices
+    void account(f64 secs, uint nframes, uint nvoices);
+    // update the limit after a block, for the given polyphony
+    void end_block(uint poly);
+
+    // the number of voices which can play now
+    uint limit() const { return limit_; }
+
+    Stats &stats() { return stats_; }
+    const Stats &stats() const { return stats_; }
+
+private:
+    // sample rate
+    f64 fs_ = 44100;
+    // share of the real time, 0 for no limit
+    f32 target_ = 0;
+    // time of a voice to render a frame, on average (s)
+    f64 voice_cost_ = 0;
+    // accumulation of the current block
+    f64 block_secs_ = 0;
+    u64 block_frames_ = 0;
+    u64 block_voice_frames_ = 0;
+    // current limit
+    uint limit_ = ~0u;
+    // counters
+    Stats stats_;
+};
+
+}  // namespace cws80
@@ -40,8 +40,14 @@ namespace lpcfmoog {
         static constexpr tuning tun = tun_table;
         static constexpr uint over = 2;
     };
+    struct eco_policy {
+        static constexpr non_linearity nl = nl_fast_tanh;
+        static constexpr tuning tun = tun_table;
+        static constexpr uint over = 1;
+    };
 
     template <class Policy> class filter;
+    typedef filter<eco_policy> eco_filter;
     typedef filter<fast_policy> fast_filter;
     typedef filter<nice_policy> nice_filter;
 
@@ -0,0 +1,134 @@
+#include "resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <assert.h>
+
+namespace dsp {
+
+// taps of the filter for an unit ratio, higher when decimating
+static constexpr uint resampler_taps = 64;
+// Kaiser window parameter, for approximately 80 dB rejection
+static constexpr f64 resampler_beta = 8;
+// cutoff, relative to the smaller of the two Nyquist frequencies
+static constexpr f64 resampler_cutoff = 0.9;
+
+// modified Bessel function of the first kind, order 0
+static f64 bessel_i0(f64 x)
+{
+    f64 sum = 1, term = 1;
+    for (uint k = 1; k < 64 && term > sum * 1e-12; ++k) {
+        f64 r = x / (2 * k);
+        term *= r * r;
+        sum += term;
+    }
+    return sum;
+}
+
+void resampler::init(f64 fsin, f64 fsout)
+{
+    f64 step = fsin / fsout;
+    step_ = step;
+
+    // when decimating, the cutoff goes down and the kernel stretches
+    //  (the FIR history wraps correctly only on powers of 2)
+    uint taps = resampler_taps;
+    while (taps < resampler_taps * step)
+        taps *= 2;
+    taps_ = taps;
+
+    f64 fc = 0.5 * resampler_cutoff * std::min(1.0, 1 / step);
+    f64 i0beta = bessel_i0(resampler_beta);
+
+    f32 *coefs = new f32[(phases + 1) * taps];
+    coefs_.reset(coefs);
+
+    for (uint r = 0; r <= phases; ++r) {
+        f32 *row = &coefs[r * taps];
+        f64 sum = 0;
+        for (uint j = 0; j < taps; ++j) {
+            // distance of the input sample j to the output point
+            f64 x = (f64)j - 0.5 * taps + (f64)r / phases;
+            f64 t = 2 * fc * x;
+            f64 sinc = (t == 0) ? 1 : std::sin(M_PI * t) / (M_PI * t);
+            f64 w = x / (0.5 * taps);
+            w = (std::fabs(w) < 1) ? bessel_i0(resampler_beta * std::sqrt(1 - w * w)) / i0beta : 0;
+            f64 c = 2 * fc * sinc * w;
+            row[j] = c;
+            sum += c;
+        }
+        // normalize for unity gain at DC
+        for (uint j = 0; j < taps; ++j)
+            row[j] /= sum;
+    }
+
+    for (realfir<f32> &fir : fir_)
+        fir = realfir<f32>(taps);
+
+    reset();
+}
+
+void resampler::reset()
+{
+    phase_ = 1;
+    for (realfir<f32> &fir : fir_)
+        fir.reset();
+}
+
+f64 resampler::latency() const
+{
+    return 0.5 * taps_ / step_;
+}
+
+uint resampler::input_frames(uint nout) const
+{
+    // same computation as the processing loop
+    f64 phase = phase_;
+    const f64 step = step_;
+    uint nin = 0;
+    for (uint i = 0; i < nout; ++i) {
+        for (; phase >= 1; phase -= 1)
+            ++nin;
+        phase += step;
+    }
+    return nin;
+}
+
+void resampler::process(const f32 *inl, const f32 *inr, uint nin,
+                        f32 *outl, f32 *outr, uint nout)
+{
+    f64 phase = phase_;
+    const f64 step = step_;
+    const uint taps = taps_;
+    const f32 *coefs = coefs_.get();
+    realfir<f32> &firl = fir_[0];
+    realfir<f32> &firr = fir_[1];
+
+    uint j = 0;
+    for (uint i = 0; i < nout; ++i) {
+        for (; phase >= 1; phase -= 1) {
+            assert(j < nin);
+            firl.in(inl[j]);
+            firr.in(inr[j]);
+            ++j;
+        }
+
+        f64 pos = phase * phases;
+        uint r = (uint)pos;
+        f32 mu = pos - r;
+        const f32 *c0 = &coefs[r * taps];
+        const f32 *c1 = c0 + taps;
+
+        f32 l0 = firl.out(c0), l1 = firl.out(c1);
+        f32 r0 = firr.out(c0), r1 = firr.out(c1);
+        outl[i] = l0 + mu * (l1 - l0);
+        outr[i] = r0 + mu * (r1 - r0);
+
+        phase += step;
+    }
+    assert(j == nin);
+    (void)nin;
+
+    phase_ = phase;
+}
+
+}  // namespace dsp
@@ -0,0 +1,39 @@
+#pragma once
+#include "utility/filter.h"
+#include "utility/types.h"
+#include <memory>
+
+namespace dsp {
+
+// polyphase windowed-sinc resampler of a stereo stream, with a fixed ratio
+class resampler {
+public:
+    void init(f64 fsin, f64 fsout);
+    void reset();
+
+    // delay of the output stream, in output frames
+    f64 latency() const;
+
+    // count of input frames to consume for the next given output frames
+    uint input_frames(uint nout) const;
+
+    // convert the input, which has the count given by input_frames(nout)
+    void process(const f32 *inl, const f32 *inr, uint nin,
+                 f32 *outl, f32 *outr, uint nout);
+
+private:
+    // number of polyphase rows, interpolated linearly
+    static constexpr uint phases = 256;
+    // ratio of input frames per output frame
+    f64 step_ = 1;
+    // position of the next output, relative to the last input
+    f64 phase_ = 1;
+    // length of the filter
+    uint taps_ = 0;
+    // coefficients of the filter, (phases + 1) rows of taps
+    std::unique_ptr<f32[]> coefs_;
+    // input history of the channels
+    realfir<f32> fir_[2];
+};
+
+}  // namespace dsp
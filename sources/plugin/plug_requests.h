@@ -0,0 +1,70 @@
+#pragma once
+#include "cws/cws80_ins.h"
+#include "cws/cws80_messages.h"
+
+namespace cws80 {
+
+// receive the pending requests in order, up to a number of bytes
+//  the first request is always received, whatever its size
+//  consecutive parameter changes of the same index keep the last value
+//  notes go to the scheduler, which returns false when it is full
+// returns the number of bytes consumed
+template <class RB, class NoteScheduler>
+size_t receive_requests(RB &rb, Instrument &ins, size_t budget,
+                        NoteScheduler &&schedule)
+{
+    alignas(Request::T) u8 data[RequestTraits::max_size()];
+    const Request::T &req = *reinterpret_cast<const Request::T *>(data);
+
+    Request::SetParameter param;
+    bool have_param = false;
+
+    size_t used = 0;
+    for (Request::T hdr; rb.peek(hdr);) {
+        RequestTraits tr(hdr.type);
+        size_t size = tr.size();
+        if (used > 0 && used + size > budget)
+            break;
+        if (!rb.peek(data, size))
+            break;
+
+        switch (hdr.type) {
+        case RequestType::SetParameter: {
+            auto &set = (const Request::SetParameter &)req;
+            if (have_param && param.index != set.index)
+                ins.receive_request(param);
+            param.index = set.index;
+            param.value = set.value;
+            have_param = true;
+            break;
+        }
+        case RequestType::NoteOn:
+        case RequestType::NoteOff:
+            if (have_param) {
+                ins.receive_request(param);
+                have_param = false;
+            }
+            if (!schedule(req))
+                goto full;
+            break;
+        default:
+            if (have_param) {
+                ins.receive_request(param);
+                have_param = false;
+            }
+            ins.receive_request(req);
+            break;
+        }
+
+        rb.discard(size);
+        used += size;
+    }
+
+full:
+    if (have_param)
+        ins.receive_request(param);
+
+    return used;
+}
+
+}  // namespace cws80
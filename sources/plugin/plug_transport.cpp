@@ -0,0 +1,313 @@
+#include "plugin/plug_transport.h"
+#include "utility/debug.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <new>
+#include <random>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <climits>
+#endif
+
+namespace cws80 {
+
+//------------------------------------------------------------------------------
+size_t Shared_Ring_Buffer::size_used() const
+{
+    return wp_.load(std::memory_order_acquire) - rp_.load(std::memory_order_relaxed);
+}
+
+size_t Shared_Ring_Buffer::size_free() const
+{
+    return capacity - (wp_.load(std::memory_order_relaxed) - rp_.load(std::memory_order_acquire));
+}
+
+bool Shared_Ring_Buffer::discard(size_t len)
+{
+    if (size_used() < len)
+        return false;
+    rp_.store(rp_.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    return true;
+}
+
+bool Shared_Ring_Buffer::peekbytes_(void *data, size_t len) const
+{
+    u32 rp = rp_.load(std::memory_order_relaxed);
+    if (wp_.load(std::memory_order_acquire) - rp < len)
+        return false;
+    size_t pos = rp & (capacity - 1);
+    size_t n1 = std::min<size_t>(len, capacity - pos);
+    memcpy(data, &data_[pos], n1);
+    memcpy((u8 *)data + n1, &data_[0], len - n1);
+    return true;
+}
+
+bool Shared_Ring_Buffer::getbytes_(void *data, size_t len)
+{
+    if (!peekbytes_(data, len))
+        return false;
+    rp_.store(rp_.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    return true;
+}
+
+bool Shared_Ring_Buffer::putbytes_(const void *data, size_t len)
+{
+    u32 wp = wp_.load(std::memory_order_relaxed);
+    if (capacity - (wp - rp_.load(std::memory_order_acquire)) < len)
+        return false;
+    size_t pos = wp & (capacity - 1);
+    size_t n1 = std::min<size_t>(len, capacity - pos);
+    memcpy(&data_[pos], data, n1);
+    memcpy(&data_[0], (const u8 *)data + n1, len - n1);
+    wp_.store(wp + len, std::memory_order_seq_cst);
+    wake();
+    return true;
+}
+
+#if defined(__linux__)
+static long futex(std::atomic<u32> *addr, int op, u32 val, const timespec *timeout)
+{
+    // not private, the word may be shared with another process
+    return syscall(SYS_futex, reinterpret_cast<u32 *>(addr), op, val, timeout, nullptr, 0);
+}
+#endif
+
+bool Shared_Ring_Buffer::wait(u32 timeout_ms)
+{
+    u32 wp = wp_.load(std::memory_order_seq_cst);
+    if (wp != rp_.load(std::memory_order_relaxed))
+        return true;
+
+#if defined(__linux__)
+    waiting_.store(1, std::memory_order_seq_cst);
+    if (wp_.load(std::memory_order_seq_cst) == wp) {
+        timespec ts;
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        futex(&wp_, FUTEX_WAIT, wp, &ts);
+    }
+    waiting_.store(0, std::memory_order_relaxed);
+#else
+    // no wakeup, poll at a short interval instead
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (wp_.load(std::memory_order_acquire) == wp &&
+           std::chrono::steady_clock::now() < until)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+
+    return size_used() > 0;
+}
+
+void Shared_Ring_Buffer::wake()
+{
+#if defined(__linux__)
+    // a system call only if the consumer sleeps
+    if (waiting_.load(std::memory_order_seq_cst))
+        futex(&wp_, FUTEX_WAKE, INT_MAX, nullptr);
+#endif
+}
+
+//------------------------------------------------------------------------------
+static constexpr u32 transport_magic = 0x63777338;  // 'cws8'
+static constexpr u32 transport_version = 3;
+static constexpr u32 transport_id_mask = (1u << 24) - 1;
+
+// the private transports of this process, by index
+static std::mutex Transport_private_mutex;
+static std::map<u32, Transport::Layout *> Transport_private;
+
+static u32 Transport_process()
+{
+#if !defined(_WIN32)
+    return (u32)getpid() & transport_id_mask;
+#else
+    return (u32)_getpid() & transport_id_mask;
+#endif
+}
+
+static u32 Transport_token()
+{
+    u32 token = 0;
+    try {
+        token = std::random_device()();
+    }
+    catch (std::exception &) {
+        token = (u32)std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+    token &= transport_id_mask;
+    return token ? token : 1;
+}
+
+#if !defined(_WIN32)
+static std::string Transport_name(const Transport::Id &id)
+{
+    char name[64];
+    sprintf(name, "/cws80-%u-%u", id.process, id.index);
+    return name;
+}
+#endif
+
+bool Transport::Id::operator==(const Id &o) const
+{
+    return process == o.process && index == o.index && token == o.token;
+}
+
+bool Transport::create()
+{
+    close();
+
+    static std::atomic<u32> counter{0};
+    Id id;
+    id.process = Transport_process();
+    id.index = counter++ & transport_id_mask;
+    id.token = Transport_token();
+
+    Layout *layout = nullptr;
+
+#if !defined(_WIN32)
+    std::string name = Transport_name(id);
+    int fd = shm_open(name.c_str(), O_RDWR|O_CREAT|O_EXCL, 0600);
+    void *addr = MAP_FAILED;
+    if (fd != -1) {
+        if (ftruncate(fd, sizeof(Layout)) == 0)
+            addr = mmap(nullptr, sizeof(Layout), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED)
+            shm_unlink(name.c_str());
+    }
+
+    if (addr != MAP_FAILED) {
+        layout = new (addr) Layout;
+        name_ = name;
+        mapped_ = true;
+    }
+    else
+        debug("Cannot create shared memory {}, using private memory", name);
+#endif
+
+    if (!layout) {
+        layout = new Layout;
+        std::lock_guard<std::mutex> lock(Transport_private_mutex);
+        Transport_private[id.index] = layout;
+    }
+
+    layout->magic = transport_magic;
+    layout->version = transport_version;
+    layout->token = id.token;
+    layout_ = layout;
+    id_ = id;
+    owner_ = true;
+    return true;
+}
+
+bool Transport::open(const Id &id)
+{
+    close();
+
+    if (!id.valid())
+        return false;
+
+    // private memory, if the user interface is in the process of the plugin
+    if (id.process == Transport_process()) {
+        std::lock_guard<std::mutex> lock(Transport_private_mutex);
+        auto it = Transport_private.find(id.index);
+        if (it != Transport_private.end()) {
+            Layout *layout = it->second;
+            if (layout->token != id.token) {
+                debug("Private transport {} belongs to another instance", id.index);
+                return false;
+            }
+            layout_ = layout;
+            id_ = id;
+            return true;
+        }
+    }
+
+#if !defined(_WIN32)
+    std::string name = Transport_name(id);
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd == -1) {
+        debug("Cannot open shared memory {}", name);
+        return false;
+    }
+
+    struct stat st;
+    void *addr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size == sizeof(Layout))
+        addr = mmap(nullptr, sizeof(Layout), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (addr == MAP_FAILED) {
+        debug("Cannot map shared memory {}", name);
+        return false;
+    }
+
+    Layout *layout = static_cast<Layout *>(addr);
+    if (layout->magic != transport_magic || layout->version != transport_version) {
+        debug("Shared memory {} has an incompatible layout", name);
+        munmap(addr, sizeof(Layout));
+        return false;
+    }
+    // the name may have been taken again, since the plugin told it
+    if (layout->token != id.token) {
+        debug("Shared memory {} belongs to another instance", name);
+        munmap(addr, sizeof(Layout));
+        return false;
+    }
+
+    layout_ = layout;
+    id_ = id;
+    name_ = name;
+    mapped_ = true;
+    return true;
+#else
+    debug("Cannot open the transport of another process");
+    return false;
+#endif
+}
+
+void Transport::close()
+{
+    Layout *layout = layout_;
+    if (!layout)
+        return;
+
+    if (!mapped_) {
+        if (owner_) {
+            std::lock_guard<std::mutex> lock(Transport_private_mutex);
+            Transport_private.erase(id_.index);
+            delete layout;
+        }
+    }
+#if !defined(_WIN32)
+    else {
+        if (owner_) {
+            layout->~Layout();
+            shm_unlink(name_.c_str());
+        }
+        munmap(layout, sizeof(Layout));
+    }
+#endif
+
+    layout_ = nullptr;
+    id_ = Id();
+    name_.clear();
+    owner_ = false;
+    mapped_ = false;
+}
+
+}  // namespace cws80
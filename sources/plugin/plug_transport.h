@@ -0,0 +1,109 @@
+#pragma once
+#include "cws/cws80_bank_pool.h"
+#include "utility/types.h"
+#include "ring_buffer.h"
+#include <atomic>
+#include <string>
+
+namespace cws80 {
+
+//------------------------------------------------------------------------------
+// ring of bytes which lives at a fixed place in memory, possibly shared
+//  between processes, with a single producer and a single consumer
+class Shared_Ring_Buffer final :
+    private Basic_Ring_Buffer<Shared_Ring_Buffer> {
+private:
+    typedef Basic_Ring_Buffer<Shared_Ring_Buffer> Base;
+
+public:
+    enum { capacity = 65536 };
+
+    // read operations
+    size_t size_used() const;
+    bool discard(size_t len);
+    using Base::get;
+    using Base::peek;
+    // write operations
+    size_t size_free() const;
+    using Base::put;
+
+    // wait until the ring has data, or the time has passed (consumer)
+    //  the producer wakes the consumer only when it is waiting
+    bool wait(u32 timeout_ms);
+
+private:
+    friend Base;
+    bool getbytes_(void *data, size_t len);
+    bool peekbytes_(void *data, size_t len) const;
+    bool putbytes_(const void *data, size_t len);
+    void wake();
+
+private:
+    std::atomic<u32> rp_{0}, wp_{0};
+    // whether the consumer is waiting for the write pointer to change
+    std::atomic<u32> waiting_{0};
+    u8 data_[capacity];
+};
+
+#if defined(__cpp_lib_atomic_is_always_lock_free)
+static_assert(std::atomic<u32>::is_always_lock_free,
+              "atomic<u32> must be lock free to be shared between processes");
+#endif
+
+//------------------------------------------------------------------------------
+// memory exchanged by the plugin and its user interface, which may be in a
+//  different process. it contains the message rings and the bank pool, so the
+//  wire layout is the same as in process and loaded banks are not copied.
+class Transport {
+public:
+    struct Layout {
+        u32 magic;
+        u32 version;
+        // random number of the instance which created it
+        u32 token;
+        Shared_Ring_Buffer requests;
+        Shared_Ring_Buffer notifications;
+        BankPool::Storage banks;
+    };
+
+    // what the user interface needs to find a transport, not a name but
+    //  numbers under 2^24, which pass exactly as parameter values
+    struct Id {
+        u32 process = 0;
+        u32 index = 0;
+        u32 token = 0;
+        bool valid() const { return token != 0; }
+        bool operator==(const Id &o) const;
+        bool operator!=(const Id &o) const { return !operator==(o); }
+    };
+
+    Transport() {}
+    ~Transport() { close(); }
+
+    // create a new segment with a unique name (plugin)
+    //  where shared memory is not available, the memory is private, and only
+    //  a user interface in the same process can open it
+    bool create();
+    // open the segment of a plugin instance (user interface)
+    //  a segment which has the name but not the token of the instance is refused
+    bool open(const Id &id);
+    void close();
+
+    const Id &id() const { return id_; }
+    // the name of the shared segment, empty if private
+    const std::string &name() const { return name_; }
+    Layout *layout() const { return layout_; }
+
+private:
+    Layout *layout_ = nullptr;
+    Id id_;
+    std::string name_;
+    bool owner_ = false;
+    bool mapped_ = false;
+
+private:
+    Transport(const Transport &) = delete;
+    Transport &operator=(const Transport &) = delete;
+};
+
+}  // namespace cws80
@@ -1,5 +1,6 @@
 #pragma once
 #include "cws/cws80_messages.h"
+#include "cws/cws80_bank_pool.h"
 #include "utility/types.h"
 
 namespace cws80 {
@@ -11,6 +12,8 @@ public:
     virtual void set_parameter_automated(uint idx, i32 val) = 0;
     virtual void begin_edit(uint idx) = 0;
     virtual void end_edit(uint idx) = 0;
+    // banks shared with the instrument, nullptr if not connected
+    virtual BankPool *bank_pool() = 0;
 };
 
 }  // namespace cws80
@@ -8,29 +8,27 @@
 #include "utility/path.h"
 #include "utility/string.h"
 #include "utility/dynarray.h"
+#include "utility/container/slot_queue.h"
 #include "utility/debug.h"
 #include <nuklear.h>
 #include <fmt/format.h>
 #include <gsl/gsl>
 #include <algorithm>
+#include <array>
 #include <functional>
 #include <utility>
 #include <chrono>
 #include <string>
 #include <deque>
 #include <thread>
-#include <mutex>
 #include <cstdio>
+#include <cstring>
 #include <unistd.h>
 
 namespace cws80 {
 
 namespace stc = std::chrono;
 
-//------------------------------------------------------------------------------
-struct Notification_Delete { void operator()(const Notification::T *x) const noexcept { NotificationTraits::free(x); } };
-typedef std::unique_ptr<Notification::T, Notification_Delete> Notification_u;
-
 //------------------------------------------------------------------------------
 struct UI::Impl {
     UI *Q = nullptr;
@@ -43,17 +41,18 @@ struct UI::Impl {
     uint prognum_ = 0;
     uint banknum_ = 0;
     dynarray<std::string> prognames_{4 * 128};
+    // copy of the banks of the instrument, up to date with notifications
+    std::array<Bank, 4> banks_{};
     std::string dir_loadbank_;
     std::string ledtext_;
     std::string ledtext_prio_;
     f64 led_timeout_ = 0;
     stc::steady_clock::time_point led_start_;
     std::string statustext_;
-    std::deque<Notification_u> ntfqueue_;
-    std::mutex ntfqueuesync_;
+    slot_queue<NotificationTraits::max_size(), 64> ntfqueue_;
     cxx::optional<uint> edited_parameter_;
-    Notification_u take_notification();
     void handle_notification(const Notification::T &ntf);
+    void update_program_name(uint num, uint slot);
     void load_bank(const std::string &path);
     void save_bank(const std::string &path);
 
@@ -109,10 +108,7 @@ bool UI::update()
 {
     NkScreen &screen = P->screen_;
 
-    while (Notification_u ntf = P->take_notification()) {
-        P->async_process_exec(*ntf);
-        P->handle_notification(*ntf);
-    }
+    process_notifications();
 
     bool interactible = true;
     if (!P->async_process_complete())
@@ -136,41 +132,61 @@ void UI::update_display()
 }
 
 //------------------------------------------------------------------------------
-void UI::receive_notification(const Notification::T &ntf)
+Notification::T *UI::notification_slot()
+{
+    return static_cast<Notification::T *>(P->ntfqueue_.back());
+}
+
+void UI::commit_notification()
 {
-    Notification_u copy(NotificationTraits::clone(ntf));
-    std::lock_guard<std::mutex> guard(P->ntfqueuesync_);
-    P->ntfqueue_.push_back(std::move(copy));
+    P->ntfqueue_.push();
 }
 
-Notification_u UI::Impl::take_notification()
+bool UI::receive_notification(const Notification::T &ntf)
 {
-    std::lock_guard<std::mutex> guard(ntfqueuesync_);
-    auto &queue = ntfqueue_;
-    Notification_u res;
-    if (!queue.empty()) {
-        res = std::move(queue.front());
-        queue.pop_front();
+    Notification::T *slot = notification_slot();
+    if (!slot)
+        return false;
+    NotificationTraits tr(ntf.type);
+    memcpy(static_cast<void *>(slot), &ntf, tr.size());
+    commit_notification();
+    return true;
+}
+
+void UI::process_notifications()
+{
+    auto &queue = P->ntfqueue_;
+    while (const void *slot = queue.front()) {
+        const Notification::T &ntf = *static_cast<const Notification::T *>(slot);
+        P->handle_notification(ntf);
+        P->async_process_exec(ntf);
+        queue.pop();
     }
-    return res;
 }
 
 void UI::Impl::handle_notification(const Notification::T &ntf)
 {
     switch (ntf.type) {
-    case NotificationType::Bank: {
-        auto &bankntf = static_cast<const Notification::Bank &>(ntf);
-        const Bank &bank = bankntf.data;
-        uint num = bankntf.num;
-        if (num >= 4)
+    case NotificationType::BankSlots: {
+        auto &slotntf = static_cast<const Notification::BankSlots &>(ntf);
+        uint num = slotntf.num;
+        uint count = slotntf.count;
+        if (num >= 4 || count > slotntf.max_count)
             return;  // bad message
-        char namebuf[8];
-        uint i = 0, n = bank.pgm_count;
-        uint j = num * 128;
-        for (; i < n; ++i)
-            prognames_[i + j] = bank.pgm[i].name(namebuf);
-        for (; i < 128; ++i)
-            prognames_[i + j] = "------";
+        Bank &bank = banks_[num];
+        bool recount = bank.pgm_count != slotntf.pgm_count;
+        bank.pgm_count = slotntf.pgm_count;
+        for (uint i = 0; i < count; ++i) {
+            uint slot = slotntf.slot[i];
+            if (slot >= 128)
+                continue;  // bad message
+            bank.pgm[slot] = slotntf.pgm[i];
+            update_program_name(num, slot);
+        }
+        if (recount) {
+            for (uint slot = 0; slot < 128; ++slot)
+                update_program_name(num, slot);
+        }
         break;
     }
     case NotificationType::Program: {
@@ -184,12 +200,27 @@ void UI::Impl::handle_notification(const Notification::T &ntf)
         prognames_[pgmntf.prog + pgmntf.bank * 128] = pgmntf.data.name(namebuf);
         break;
     }
+    case NotificationType::Parameters: {
+        auto &paramntf = static_cast<const Notification::Parameters &>(ntf);
+        uint count = std::min<uint>(paramntf.count, paramntf.max_count);
+        for (uint i = 0; i < count; ++i)
+            pgm_.set_parameter(paramntf.index[i], paramntf.value[i]);
+        break;
+    }
     case NotificationType::Write:
         Q->led_priority_message(2, "** WRITE SUCCESSFUL **");
         break;
     }
 }
 
+void UI::Impl::update_program_name(uint num, uint slot)
+{
+    const Bank &bank = banks_[num];
+    char namebuf[8];
+    prognames_[slot + num * 128] =
+        (slot < bank.pgm_count) ? bank.pgm[slot].name(namebuf) : "------";
+}
+
 void UI::Impl::load_bank(const std::string &path)
 {
     UIMaster &master = *master_;
@@ -212,9 +243,22 @@ void UI::Impl::load_bank(const std::string &path)
         Q->status_fmt("{}", capitalize(msg));
     }
     if (bank) {
-        Request::LoadBank req;
-        req.data = *bank;
-        master.emit_request(req);
+        // fill a bank of the pool, the audio thread takes it as is
+        BankPool *pool = master.bank_pool();
+        Bank *data = pool ? pool->acquire() : nullptr;
+        if (!pool)
+            Q->status_fmt("Cannot load, the synthesizer is not connected");
+        else if (!data)
+            Q->status_fmt("Cannot load, the previous banks are still loading");
+        else {
+            *data = *bank;
+            const Program &initpgm = initial_program();
+            for (uint i = bank->pgm_count; i < 128; ++i)
+                data->pgm[i] = initpgm;
+            Request::LoadBank req;
+            req.index = pool->index_of(data);
+            master.emit_request(req);
+        }
     }
     dir_loadbank_ = path_directory(path.c_str());
 }
@@ -228,14 +272,12 @@ void UI::Impl::save_bank(const std::string &path)
     req.bank = num;
     master.emit_request(req);
 
+    // the copy is complete when the last programs of the bank arrive
     auto async_routine = [this, path, num](const Notification::T &ntf) -> bool {
-        cxx::optional<Bank> optbank;
-        if (ntf.type == NotificationType::Bank) {
-            const auto &bnf = static_cast<const Notification::Bank &>(ntf);
-            if (bnf.num == num)
-                optbank = bnf.data;
-        }
-        if (!optbank)
+        if (ntf.type != NotificationType::BankSlots)
+            return false;
+        const auto &bnf = static_cast<const Notification::BankSlots &>(ntf);
+        if (bnf.num != num || !bnf.last)
             return false;
 
         FILE *fh = fopen(path.c_str(), "wb");
@@ -246,7 +288,7 @@ void UI::Impl::save_bank(const std::string &path)
         SCOPE(exit) { fclose(fh); };
 
         try {
-            Bank::write_sysex(fh, *optbank);
+            Bank::write_sysex(fh, banks_[num]);
             Q->status_fmt("Saved bank: {}", path);
             Q->led_priority_message(2, "** BANK SAVED **");
         }
@@ -461,18 +503,21 @@ void UI::dlg_save_bank()
 void UI::send_piano_events(const i8 events[128])
 {
     UIMaster &master = *P->master_;
+    u64 time = request_time();
     for (u8 key = 0; key < 127; ++key) {
         i8 event = events[key];
         if (event > 0) {
             Request::NoteOn noteon;
             noteon.key = key;
             noteon.velocity = event;
+            noteon.time = time;
             master.emit_request(noteon);
         }
         else if (event < 0) {
             Request::NoteOff noteoff;
             noteoff.key = key;
             noteoff.velocity = -(event + 1);
+            noteoff.time = time;
             master.emit_request(noteoff);
         }
     }
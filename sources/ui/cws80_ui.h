@@ -25,7 +25,13 @@ public:
     void render_display(void *draw_context);
     void update_display();
 
-    void receive_notification(const Notification::T &ntf);
+    // notifications are received in preallocated slots, without locks
+    //  the slot to fill with the next, or nullptr if all slots are full
+    Notification::T *notification_slot();
+    void commit_notification();
+    bool receive_notification(const Notification::T &ntf);
+    // handle all notifications received
+    void process_notifications();
 
 private:
     struct Impl;
@@ -0,0 +1,94 @@
+#include "utility/arena.h"
+#include <new>
+#include <utility>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+void *aligned_malloc(size_t size, size_t align)
+{
+#if defined(_WIN32)
+    return _aligned_malloc(size, align);
+#else
+    void *ptr = nullptr;
+    return (posix_memalign(&ptr, align, size) == 0) ? ptr : nullptr;
+#endif
+}
+
+void aligned_free(void *ptr)
+{
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+arena::arena(size_t cap)
+{
+    if (cap == 0)
+        return;
+
+    size_t align = line;
+    cap = footprint(cap);
+    if (cap >= huge_page) {
+        align = huge_page;
+        cap = (cap + huge_page - 1) & ~(huge_page - 1);
+    }
+
+    u8 *data = (u8 *)aligned_malloc(cap, align);
+    if (!data)
+        throw std::bad_alloc();
+#if defined(MADV_HUGEPAGE)
+    if (align == huge_page)
+        madvise(data, cap, MADV_HUGEPAGE);
+#endif
+    memset(data, 0, cap);
+
+    data_ = data;
+    cap_ = cap;
+}
+
+arena::~arena()
+{
+    aligned_free(data_);
+}
+
+arena::arena(arena &&o) noexcept
+    : data_(o.data_)
+    , top_(o.top_)
+    , cap_(o.cap_)
+{
+    o.data_ = nullptr;
+    o.top_ = o.cap_ = 0;
+}
+
+arena &arena::operator=(arena &&o) noexcept
+{
+    if (this != &o) {
+        aligned_free(data_);
+        data_ = o.data_;
+        top_ = o.top_;
+        cap_ = o.cap_;
+        o.data_ = nullptr;
+        o.top_ = o.cap_ = 0;
+    }
+    return *this;
+}
+
+void *arena::allocate(size_t size) noexcept
+{
+    size_t totalsize = footprint(size);
+    if (totalsize > cap_ - top_) {
+        assert(false);
+        return nullptr;
+    }
+    u8 *block = data_ + top_;
+    top_ += totalsize;
+    return block;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "utility/types.h"
+#include <cstddef>
+
+//------------------------------------------------------------------------------
+// one block of memory, aligned to cache lines and zeroed, divided once
+//  the parts are never freed separately, they all go with the arena
+//  a large block is aligned to huge pages, and the system is advised to use them
+class arena {
+public:
+    static constexpr size_t line = 64;
+    static constexpr size_t huge_page = 2 << 20;
+
+    arena() {}
+    explicit arena(size_t cap);
+    ~arena();
+
+    arena(arena &&o) noexcept;
+    arena &operator=(arena &&o) noexcept;
+    arena(const arena &) = delete;
+    arena &operator=(const arena &) = delete;
+
+    // size of an allocation, including the padding to the next cache line
+    static constexpr size_t footprint(size_t size)
+    {
+        return (size + line - 1) & ~(line - 1);
+    }
+
+    const void *data() const { return data_; }
+    size_t allocated() const { return top_; }
+    size_t capacity() const { return cap_; }
+
+    // take zeroed memory aligned to a cache line, or null if full
+    void *allocate(size_t size) noexcept;
+    template <class T> T *allocate_array(size_t count) noexcept
+    {
+        return static_cast<T *>(allocate(count * sizeof(T)));
+    }
+
+private:
+    u8 *data_ = nullptr;
+    size_t top_ = 0, cap_ = 0;
+};
+
+// memory with an alignment which operator new does not guarantee
+void *aligned_malloc(size_t size, size_t align);
+void aligned_free(void *ptr);
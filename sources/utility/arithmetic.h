@@ -4,6 +4,9 @@
 #include <gsl/gsl>
 #include <cfenv>
 #include <cassert>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 #define scoped_fesetround(mode)                                  \
     int SCOPE_GUARD_PP_UNIQUE(_rounding_mode) = fegetround();    \
@@ -14,6 +17,28 @@
 
 template <class T> inline T square(T a) { return a * a; }
 
+// count of trailing zero bits, x must be nonzero
+inline uint ctz(u64 x)
+{
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward64(&i, x);
+    return i;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+// count of one bits
+inline uint popcount(u64 x)
+{
+#if defined(_MSC_VER)
+    return (uint)__popcnt64(x);
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
 template <class T> inline T cube(T a) { return a * a * a; }
 
 template <class T> inline T clamp(T x, T min, T max)
@@ -30,14 +55,19 @@ template <class R> R itp_linear(const R y[], R mu)
 }
 
 // Catmull-Rom interpolator
-template <class R> R itp_catmull(const R y[], R mu)
+template <class R> R itp_catmull(R y0, R y1, R y2, R y3, R mu)
 {
     R mu2 = mu * mu;
     R mu3 = mu2 * mu;
-    R a[] = {-R(0.5) * y[0] + R(1.5) * y[1] - R(1.5) * y[2] + R(0.5) * y[3],
-             y[0] - R(2.5) * y[1] + R(2) * y[2] - R(0.5) * y[3],
-             -R(0.5) * y[0] + R(0.5) * y[2], y[1]};
-    return a[0] * mu3 + a[1] * mu2 + a[2] * mu + a[3];
+    R a0 = -R(0.5) * y0 + R(1.5) * y1 - R(1.5) * y2 + R(0.5) * y3;
+    R a1 = y0 - R(2.5) * y1 + R(2) * y2 - R(0.5) * y3;
+    R a2 = -R(0.5) * y0 + R(0.5) * y2;
+    return a0 * mu3 + a1 * mu2 + a2 * mu + y1;
+}
+
+template <class R> R itp_catmull(const R y[], R mu)
+{
+    return itp_catmull(y[0], y[1], y[2], y[3], mu);
 }
 
 //------------------------------------------------------------------------------
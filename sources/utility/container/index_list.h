@@ -0,0 +1,131 @@
+/*
+  index_lists: doubly linked lists of the integers 0...N-1, in L lists
+    the links are arrays of indices, an integer is in at most one list
+    insertion, removal and moving are in constant time, and never allocate
+*/
+
+#pragma once
+#include <iterator>
+#include <type_traits>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+template <size_t N, size_t L = 1> class index_lists {
+public:
+    typedef typename std::conditional<
+        (N < 0xff && L < 0xff), uint8_t, uint16_t>::type index_type;
+    static_assert(N < 0xffff && L < 0xffff, "too many elements");
+
+    // the end of a list, and the list of an unlinked integer
+    static constexpr size_t none = N;
+
+    class const_iterator;
+    struct range_type {
+        const_iterator b, e;
+        const_iterator begin() const { return b; }
+        const_iterator end() const { return e; }
+    };
+
+    index_lists() { clear(); }
+
+    void clear()
+    {
+        for (size_t l = 0; l < L; ++l) {
+            head_[l] = tail_[l] = N;
+            size_[l] = 0;
+        }
+        for (size_t i = 0; i < N; ++i) {
+            prev_[i] = next_[i] = N;
+            list_[i] = L;
+        }
+    }
+
+    size_t size(size_t l) const { return size_[l]; }
+    bool empty(size_t l) const { return size_[l] == 0; }
+
+    // first and last of a list, or none
+    size_t front(size_t l) const { return head_[l]; }
+    size_t back(size_t l) const { return tail_[l]; }
+    // neighbors in the list, or none
+    size_t next(size_t i) const { return next_[i]; }
+    size_t prev(size_t i) const { return prev_[i]; }
+
+    // the list which has the integer, or L
+    size_t list_of(size_t i) const { return list_[i]; }
+    bool linked(size_t i) const { return list_[i] != L; }
+
+    // insert at the front, moving it if it is in a list
+    void push_front(size_t l, size_t i)
+    {
+        erase(i);
+        size_t h = head_[l];
+        prev_[i] = N;
+        next_[i] = h;
+        (h != N ? prev_[h] : tail_[l]) = i;
+        head_[l] = i;
+        list_[i] = l;
+        ++size_[l];
+    }
+
+    // insert at the back, moving it if it is in a list
+    void push_back(size_t l, size_t i)
+    {
+        erase(i);
+        size_t t = tail_[l];
+        next_[i] = N;
+        prev_[i] = t;
+        (t != N ? next_[t] : head_[l]) = i;
+        tail_[l] = i;
+        list_[i] = l;
+        ++size_[l];
+    }
+
+    // remove from its list, if any
+    void erase(size_t i)
+    {
+        assert(i < N);
+        size_t l = list_[i];
+        if (l == L)
+            return;
+        size_t p = prev_[i], n = next_[i];
+        (p != N ? next_[p] : head_[l]) = n;
+        (n != N ? prev_[n] : tail_[l]) = p;
+        prev_[i] = next_[i] = N;
+        list_[i] = L;
+        --size_[l];
+    }
+
+    // iteration of a list, which is invalid if the current integer moves
+    range_type range(size_t l) const
+    {
+        return range_type{const_iterator(this, head_[l]), const_iterator(this, N)};
+    }
+
+    class const_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef size_t value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const size_t *pointer;
+        typedef size_t reference;
+
+        const_iterator() {}
+        const_iterator(const index_lists *lists, size_t i) : lists_(lists), i_(i) {}
+        size_t operator*() const { return i_; }
+        const_iterator &operator++() { i_ = lists_->next_[i_]; return *this; }
+        const_iterator operator++(int) { const_iterator t = *this; ++*this; return t; }
+        bool operator==(const const_iterator &o) const { return i_ == o.i_; }
+        bool operator!=(const const_iterator &o) const { return i_ != o.i_; }
+
+    private:
+        const index_lists *lists_ = nullptr;
+        size_t i_ = N;
+    };
+
+private:
+    index_type head_[L], tail_[L];
+    index_type size_[L];
+    index_type prev_[N], next_[N];
+    index_type list_[N];
+};
@@ -0,0 +1,55 @@
+/*
+  slot_queue: single-producer single-consumer queue of fixed-size slots
+    the slots are preallocated, and filled and read in place
+    the producer and the consumer never wait, nor allocate
+*/
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+template <size_t SlotSize, size_t N> class slot_queue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "the capacity must be a power of 2");
+
+private:
+    struct alignas(std::max_align_t) slot {
+        unsigned char data[SlotSize];
+    };
+    std::unique_ptr<slot[]> slots_{new slot[N]};
+    std::atomic<size_t> rp_{0}, wp_{0};
+
+public:
+    static constexpr size_t slot_size() { return SlotSize; }
+    static constexpr size_t capacity() { return N; }
+
+    // producer: the next slot to fill, or nullptr if the queue is full
+    void *back()
+    {
+        size_t wp = wp_.load(std::memory_order_relaxed);
+        if (wp - rp_.load(std::memory_order_acquire) == N)
+            return nullptr;
+        return slots_[wp & (N - 1)].data;
+    }
+
+    // producer: publish the slot which was filled
+    void push()
+    {
+        wp_.store(wp_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // consumer: the oldest slot, or nullptr if the queue is empty
+    const void *front() const
+    {
+        size_t rp = rp_.load(std::memory_order_relaxed);
+        if (wp_.load(std::memory_order_acquire) == rp)
+            return nullptr;
+        return slots_[rp & (N - 1)].data;
+    }
+
+    // consumer: release the oldest slot
+    void pop()
+    {
+        rp_.store(rp_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
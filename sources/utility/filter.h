@@ -2,21 +2,34 @@
 #include "utility/arithmetic.h"
 #include "utility/types.h"
 #include <memory>
+#include <assert.h>
 
 template <class S> struct basic_fir_fx {
     basic_fir_fx() {}
     explicit basic_fir_fx(uint taps)
         : n_(taps)
-        , h_(new S[2 * taps]())
+        , cap_(taps)
+        , own_(new S[2 * taps]())
+    {
+        h_ = own_.get();
+    }
+    // the history is in external memory of 2 * taps, zeroed
+    basic_fir_fx(S *h, uint taps)
+        : n_(taps)
+        , cap_(taps)
+        , h_(h)
     {
     }
 
     void reset();
+    // change the number of taps within capacity, and clear the history
+    void resize(uint taps);
     void in(S x);
     template <class C> S out(const C *coef) const;
 
-    uint i_ = 0, n_ = 0;
-    std::unique_ptr<S[]> h_;
+    uint i_ = 0, n_ = 0, cap_ = 0;
+    S *h_ = nullptr;
+    std::unique_ptr<S[]> own_;
 };
 
 //------------------------------------------------------------------------------
@@ -28,11 +41,19 @@ template <class S> struct realfir;  // real
 //------------------------------------------------------------------------------
 template <class S> inline void basic_fir_fx<S>::reset()
 {
-    S *h = h_.get();
+    S *h = h_;
     for (uint i = 0, n = 2 * n_; i < n; ++i)
         h[i] = 0;
 }
 
+template <class S> inline void basic_fir_fx<S>::resize(uint taps)
+{
+    assert(taps <= cap_);
+    n_ = taps;
+    i_ = 0;
+    reset();
+}
+
 template <class S> inline void basic_fir_fx<S>::in(S x)
 {
     uint n = n_;
@@ -55,7 +76,7 @@ inline S fir16<S>::out(const C *__restrict coef) const
     i32 sum = 0;
     uint i = this->i_;
     const uint n = this->n_;
-    const S *__restrict h = this->h_.get();
+    const S *__restrict h = this->h_;
 #pragma omp simd reduction(+ : sum)
     for (uint j = 0; j < n; ++j)
         sum += (i32)coef[j] * (i32)h[i + j];
@@ -75,7 +96,7 @@ inline S fir16l<S>::out(const C *__restrict coef) const
     i32 sum = 0;
     uint i = this->i_;
     const uint n = this->n_;
-    const S *__restrict h = this->h_.get();
+    const S *__restrict h = this->h_;
 #pragma omp simd reduction(+ : sum)
     for (uint j = 0; j < n; ++j)
         sum += (i32)coef[j] * (i32)h[i + j];
@@ -95,7 +116,7 @@ inline S fir32l<S>::out(const C *__restrict coef) const
     i64 sum = 0;
     uint i = this->i_;
     const uint n = this->n_;
-    const S *__restrict h = this->h_.get();
+    const S *__restrict h = this->h_;
 #pragma omp simd reduction(+ : sum)
     for (uint j = 0; j < n; ++j)
         sum += (i64)coef[j] * (i64)h[i + j];
@@ -115,7 +136,7 @@ inline S realfir<S>::out(const C *__restrict coef) const
     S sum = 0;
     uint i = this->i_;
     const uint n = this->n_;
-    const S *__restrict h = this->h_.get();
+    const S *__restrict h = this->h_;
 #pragma omp simd reduction(+ : sum)
     for (uint j = 0; j < n; ++j)
         sum += coef[j] * h[i + j];
@@ -15,7 +15,14 @@ template <uint Log2Al = 4> class pb_alloc {
 public:
     pb_alloc() {}
     explicit pb_alloc(size_t cap)
-        : data_(new u8[cap])
+        : own_(new u8[cap])
+        , cap_(cap)
+    {
+        data_ = own_.get();
+    }
+    // use external memory, aligned
+    pb_alloc(void *data, size_t cap)
+        : data_((u8 *)data)
         , cap_(cap)
     {
     }
@@ -45,7 +52,8 @@ public:
     void free(const void *ptr) noexcept;
 
 private:
-    std::unique_ptr<u8[]> data_;
+    u8 *data_ = nullptr;
+    std::unique_ptr<u8[]> own_;
     size_t top_ = 0, cap_ = 0;
 };
 
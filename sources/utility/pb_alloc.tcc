@@ -2,15 +2,18 @@
 
 template <uint Log2Al>
 pb_alloc<Log2Al>::pb_alloc(pb_alloc &&o) noexcept
-    : data_(std::move(o.data_)), top_(o.top_), cap_(o.cap_) {
+    : data_(o.data_), own_(std::move(o.own_)), top_(o.top_), cap_(o.cap_) {
+  o.data_ = nullptr;
   o.top_ = o.cap_ = 0;
 }
 
 template <uint Log2Al>
 auto pb_alloc<Log2Al>::operator=(pb_alloc &&o) noexcept -> pb_alloc & {
-  data_ = std::move(o.data_);
+  data_ = o.data_;
+  own_ = std::move(o.own_);
   top_ = o.top_;
   cap_  = o.cap_;
+  o.data_ = nullptr;
   o.top_ = o.cap_ = 0;
   return *this;
 }
@@ -0,0 +1,61 @@
+#include "utility/resident.h"
+#include "utility/types.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+size_t memory_page_size()
+{
+    static const size_t size = []() -> size_t {
+#if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        long size = sysconf(_SC_PAGESIZE);
+        return (size > 0) ? (size_t)size : 4096;
+#endif
+    }();
+    return size;
+}
+
+void prefault_memory(const void *data, size_t size)
+{
+    if (size == 0)
+        return;
+
+    size_t page = memory_page_size();
+    uintptr_t first = (uintptr_t)data & ~(page - 1);
+    uintptr_t last = ((uintptr_t)data + size - 1) & ~(page - 1);
+
+    // the reads are volatile, they happen even if the values are unused
+    for (uintptr_t p = first; p <= last; p += page) {
+        const volatile u8 *byte = (const volatile u8 *)((p < (uintptr_t)data) ? (uintptr_t)data : p);
+        (void)*byte;
+    }
+}
+
+bool lock_memory(const void *data, size_t size)
+{
+    if (size == 0)
+        return true;
+#if defined(_WIN32)
+    return VirtualLock((void *)data, size) != 0;
+#else
+    return mlock(data, size) == 0;
+#endif
+}
+
+void unlock_memory(const void *data, size_t size)
+{
+    if (size == 0)
+        return;
+#if defined(_WIN32)
+    VirtualUnlock((void *)data, size);
+#else
+    munlock(data, size);
+#endif
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+
+//------------------------------------------------------------------------------
+// residence in RAM of the memory which the audio thread reads
+//  prefaulting reads a byte of each page, so the first use does not fault
+//  locking keeps the pages in RAM, within the limit which the system allows
+
+// a region of memory
+struct memory_region {
+    const void *data;
+    size_t size;
+};
+
+// size of a page of memory
+size_t memory_page_size();
+// bring the pages of a region into memory
+void prefault_memory(const void *data, size_t size);
+// lock the pages of a region into memory, false if the system refuses
+bool lock_memory(const void *data, size_t size);
+void unlock_memory(const void *data, size_t size);
@@ -0,0 +1,56 @@
+#pragma once
+#include "utility/types.h"
+#include <atomic>
+#include <type_traits>
+#include <string.h>
+
+// value published by a single writer which never waits,
+//  and read by any threads which retry if they overlap a write
+template <class T> class seqlock {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "the value must be trivially copyable");
+
+public:
+    void store(const T &value);
+    T load() const;
+
+private:
+    static constexpr size_t words = (sizeof(T) + sizeof(u32) - 1) / sizeof(u32);
+    std::atomic<uint> seq_{0};
+    std::atomic<u32> data_[words]{};
+};
+
+//------------------------------------------------------------------------------
+template <class T> void seqlock<T>::store(const T &value)
+{
+    u32 buf[words] = {};
+    memcpy(buf, &value, sizeof(T));
+
+    uint seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < words; ++i)
+        data_[i].store(buf[i], std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+}
+
+template <class T> T seqlock<T>::load() const
+{
+    u32 buf[words];
+
+    for (uint seq1, seq2;; ) {
+        seq1 = seq_.load(std::memory_order_acquire);
+        if (seq1 & 1)
+            continue;
+        for (size_t i = 0; i < words; ++i)
+            buf[i] = data_[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        seq2 = seq_.load(std::memory_order_relaxed);
+        if (seq1 == seq2)
+            break;
+    }
+
+    T value;
+    memcpy(&value, buf, sizeof(T));
+    return value;
+}
@@ -0,0 +1,349 @@
+#include "cws/cws80_ins.h"
+#include "cws/cws80_data.h"
+#include "utility/types.h"
+#include <boost/lexical_cast.hpp>
+#include <getopt.h>
+#include <chrono>
+#include <memory>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace cws80;
+
+namespace stc = std::chrono;
+
+f64 FS = 44100;
+uint B = 64;  // block size
+f64 D = 10;  // duration
+uint N = 8;  // number of notes
+uint P = 0;  // program number
+uint V = 0;  // polyphony, 0 for default
+bool Events = false;
+f32 L = 0;  // voice budget, share of real time
+uint M = 0;  // number of parts, 0 for a single program
+Quality Q = Quality::Normal;
+bool AllQ = false;
+bool Counters = false;
+bool SharedLfos = false;
+
+static void process(Quality q);
+static void process_events(Quality q);
+static void print_budget(const Instrument &ins);
+
+// hardware counters of the cache misses, like perf stat
+struct CacheCounters {
+    enum { l1d, llc, count };
+    CacheCounters();
+    ~CacheCounters();
+    bool valid() const { return fd[l1d] != -1 && fd[llc] != -1; }
+    void start();
+    void stop(u64 misses[count]);
+    int fd[count];
+};
+
+//
+static const char usage[] =
+    "Usage: bench-ins [options]\n"
+    "   -f <sample-rate>           Set the sample rate\n"
+    "   -b <block-size>            Set the block size\n"
+    "   -d <duration>              Set the duration (in s)\n"
+    "   -n <notes>                 Set the number of held notes\n"
+    "   -P <program>               Set the program number (0..127)\n"
+    "   -v <voices>                Set the polyphony (1..128)\n"
+    "   -e                         Measure note events, <notes> on and off per block\n"
+    "   -l <budget>                Set the voice budget (in % of real time)\n"
+    "   -m <parts>                 Play the notes on parts, of programs from <program>\n"
+    "   -q <quality>               Set the quality (0-2=Eco,Normal,High)\n"
+    "   -a                         Measure all qualities\n"
+    "   -c                         Count the cache misses, if the system can\n"
+    "   -g                         Share the LFOs which do not reset\n";
+
+//
+struct BenchMaster : FxMaster {
+    bool emit_notification(const Notification::T &) override { return true; }
+};
+
+int main(int argc, char *argv[])
+{
+    for (int c; (c = getopt(argc, argv, "hf:b:d:n:P:v:el:m:q:acg")) != -1;) {
+        switch (c) {
+        case 'h':
+            fputs(usage, stderr);
+            return 1;
+        case 'f':
+            FS = boost::lexical_cast<f64>(optarg);
+            break;
+        case 'b':
+            B = boost::lexical_cast<uint>(optarg);
+            if (B <= 0)
+                throw std::logic_error("invalid block size parameter");
+            break;
+        case 'd':
+            D = boost::lexical_cast<f64>(optarg);
+            if (D <= 0)
+                throw std::logic_error("invalid duration parameter");
+            break;
+        case 'n':
+            N = boost::lexical_cast<uint>(optarg);
+            if (N > polymax)
+                throw std::logic_error("invalid number of notes");
+            break;
+        case 'P':
+            P = boost::lexical_cast<uint>(optarg);
+            if (P >= 128)
+                throw std::logic_error("invalid program parameter");
+            break;
+        case 'v':
+            V = boost::lexical_cast<uint>(optarg);
+            if (V < 1 || V > polymax)
+                throw std::logic_error("invalid polyphony parameter");
+            break;
+        case 'e':
+            Events = true;
+            break;
+        case 'l':
+            L = boost::lexical_cast<f32>(optarg) / 100;
+            if (L < 0)
+                throw std::logic_error("invalid voice budget parameter");
+            break;
+        case 'm':
+            M = boost::lexical_cast<uint>(optarg);
+            if (M > max_parts)
+                throw std::logic_error("invalid number of parts");
+            break;
+        case 'q': {
+            uint q = boost::lexical_cast<uint>(optarg);
+            if (q > (uint)Quality::High)
+                throw std::logic_error("invalid quality parameter");
+            Q = (Quality)q;
+            break;
+        }
+        case 'a':
+            AllQ = true;
+            break;
+        case 'c':
+            Counters = true;
+            break;
+        case 'g':
+            SharedLfos = true;
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    if (argc != optind)
+        exit(1);
+
+    void (*proc)(Quality) = Events ? process_events : process;
+    if (!AllQ)
+        proc(Q);
+    else {
+        for (uint q = 0; q <= (uint)Quality::High; ++q)
+            proc((Quality)q);
+    }
+    return 0;
+}
+
+static void process(Quality q)
+{
+    BenchMaster master;
+    std::unique_ptr<Instrument> ins(new Instrument(master));
+    ins->initialize(FS, B);
+    ins->set_quality(q);
+    ins->select_program(0, P);
+    ins->set_voice_budget(L);
+    ins->set_shared_lfos(SharedLfos);
+    if (V)
+        ins->set_polyphony(V);
+
+    ins->set_multitimbral(M > 0);
+    for (uint c = 0; c < M; ++c) {
+        const u8 msg[2] = {(u8)(0xc0 | c), (u8)((P + c) % 128)};
+        ins->receive_midi(msg, 2, 0);
+    }
+
+    for (uint i = 0; i < N; ++i) {
+        u8 chan = M ? (i % M) : 0;
+        const u8 msg[3] = {(u8)(0x90 | chan), (u8)(36 + 5 * i), 100};
+        ins->receive_midi(msg, 3, 0);
+    }
+
+    uint nsamples = (uint)ceil(D * FS);
+    std::unique_ptr<i16[]> outl(new i16[B]);
+    std::unique_ptr<i16[]> outr(new i16[B]);
+
+    std::unique_ptr<CacheCounters> counters;
+    if (Counters)
+        counters.reset(new CacheCounters);
+
+    if (counters)
+        counters->start();
+    stc::steady_clock::time_point start = stc::steady_clock::now();
+    for (uint i = 0; i < nsamples;) {
+        uint bs = std::min(B, nsamples - i);
+        ins->synthesize(outl.get(), outr.get(), bs);
+        i += bs;
+    }
+    stc::steady_clock::duration elapsed = stc::steady_clock::now() - start;
+    u64 misses[CacheCounters::count] = {};
+    if (counters)
+        counters->stop(misses);
+
+    f64 secs = stc::duration<f64>(elapsed).count();
+    printf("%-8s %3u notes: %8.3f s CPU for %.3f s audio, %6.2f%% of real time\n",
+           quality_name(q), N, secs, D, 100 * secs / D);
+    if (counters && counters->valid()) {
+        f64 blocks = ceil((f64)nsamples / B);
+        printf("%-8s cache misses: %12llu L1D loads, %12llu LLC, %8.1f L1D per block\n",
+               "", (unsigned long long)misses[CacheCounters::l1d],
+               (unsigned long long)misses[CacheCounters::llc],
+               misses[CacheCounters::l1d] / blocks);
+    }
+    else if (counters)
+        printf("%-8s cache misses: no hardware counters\n", "");
+    print_budget(*ins);
+}
+
+static void process_events(Quality q)
+{
+    BenchMaster master;
+    std::unique_ptr<Instrument> ins(new Instrument(master));
+    ins->initialize(FS, B);
+    ins->set_quality(q);
+    ins->select_program(0, P);
+    ins->set_voice_budget(L);
+    ins->set_shared_lfos(SharedLfos);
+    uint poly = V ? V : polymax;
+    ins->set_polyphony(poly);
+
+    // keys in a sequence of period 128, held up to the polyphony
+    std::unique_ptr<u8[]> held(new u8[poly]);
+    uint nheld = 0, oldest = 0, nextkey = 0;
+    u64 nevents = 0;
+
+    uint nsamples = (uint)ceil(D * FS);
+    std::unique_ptr<i16[]> outl(new i16[B]);
+    std::unique_ptr<i16[]> outr(new i16[B]);
+
+    stc::steady_clock::duration events{};
+    stc::steady_clock::time_point start = stc::steady_clock::now();
+    for (uint i = 0; i < nsamples;) {
+        uint bs = std::min(B, nsamples - i);
+        stc::steady_clock::time_point t = stc::steady_clock::now();
+        for (uint n = 0; n < N; ++n) {
+            if (nheld == poly) {
+                const u8 off[3] = {0x80, held[oldest], 0};
+                ins->receive_midi(off, 3, 0);
+                oldest = (oldest + 1) % poly;
+                --nheld;
+                ++nevents;
+            }
+            u8 key = nextkey;
+            nextkey = (nextkey + 37) % 128;
+            const u8 on[3] = {0x90, key, 100};
+            ins->receive_midi(on, 3, 0);
+            held[(oldest + nheld++) % poly] = key;
+            ++nevents;
+        }
+        events += stc::steady_clock::now() - t;
+        ins->synthesize(outl.get(), outr.get(), bs);
+        i += bs;
+    }
+    stc::steady_clock::duration elapsed = stc::steady_clock::now() - start;
+
+    f64 secs = stc::duration<f64>(elapsed).count();
+    f64 ns = stc::duration<f64, std::nano>(events).count() / nevents;
+    printf("%-8s %3u voices: %8.1f ns per note event, %6.2f%% of real time\n",
+           quality_name(q), poly, ns, 100 * secs / D);
+    print_budget(*ins);
+}
+
+static void print_budget(const Instrument &ins)
+{
+    if (ins.voice_budget() == 0)
+        return;
+    const VoiceBudget::Stats &stats = ins.voice_budget_stats();
+    printf("%-8s budget %.0f%%: limit %u, %llu steals, %llu sheds, %llu blocks limited, %llu overruns\n",
+           "", 100 * ins.voice_budget(), (uint)stats.limit,
+           (unsigned long long)stats.steals, (unsigned long long)stats.sheds,
+           (unsigned long long)stats.limited, (unsigned long long)stats.overruns);
+}
+
+#if defined(__linux__)
+static int open_counter(u32 type, u64 config)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+CacheCounters::CacheCounters()
+{
+    fd[l1d] = open_counter(
+        PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    fd[llc] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+}
+
+CacheCounters::~CacheCounters()
+{
+    for (int f : fd)
+        if (f != -1)
+            close(f);
+}
+
+void CacheCounters::start()
+{
+    for (int f : fd) {
+        if (f != -1) {
+            ioctl(f, PERF_EVENT_IOC_RESET, 0);
+            ioctl(f, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void CacheCounters::stop(u64 misses[count])
+{
+    for (uint i = 0; i < count; ++i) {
+        misses[i] = 0;
+        if (fd[i] != -1) {
+            ioctl(fd[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd[i], &misses[i], sizeof(u64)) != sizeof(u64))
+                misses[i] = 0;
+        }
+    }
+}
+#else
+CacheCounters::CacheCounters()
+{
+    fd[l1d] = fd[llc] = -1;
+}
+
+CacheCounters::~CacheCounters()
+{
+}
+
+void CacheCounters::start()
+{
+}
+
+void CacheCounters::stop(u64 misses[count])
+{
+    for (uint i = 0; i < count; ++i)
+        misses[i] = 0;
+}
+#endif
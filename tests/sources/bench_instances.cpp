@@ -0,0 +1,104 @@
+#include "cws/cws80_ins.h"
+#include "utility/types.h"
+#include <boost/lexical_cast.hpp>
+#include <getopt.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+using namespace cws80;
+
+namespace stc = std::chrono;
+
+f64 FS = 44100;
+uint B = 64;  // block size
+uint N = 100;  // number of instruments
+uint R = 10;  // number of resets
+
+//
+static const char usage[] =
+    "Usage: bench-instances [options]\n"
+    "   -f <sample-rate>           Set the sample rate\n"
+    "   -b <block-size>            Set the block size\n"
+    "   -n <count>                 Set the number of instruments\n"
+    "   -r <count>                 Set the number of resets of each instrument\n";
+
+//
+struct BenchMaster : FxMaster {
+    bool emit_notification(const Notification::T &) override { return true; }
+};
+
+int main(int argc, char *argv[])
+{
+    for (int c; (c = getopt(argc, argv, "hf:b:n:r:")) != -1;) {
+        switch (c) {
+        case 'h':
+            fputs(usage, stderr);
+            return 1;
+        case 'f':
+            FS = boost::lexical_cast<f64>(optarg);
+            break;
+        case 'b':
+            B = boost::lexical_cast<uint>(optarg);
+            if (B <= 0)
+                throw std::logic_error("invalid block size parameter");
+            break;
+        case 'n':
+            N = boost::lexical_cast<uint>(optarg);
+            if (N <= 0)
+                throw std::logic_error("invalid number of instruments");
+            break;
+        case 'r':
+            R = boost::lexical_cast<uint>(optarg);
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    if (argc != optind)
+        exit(1);
+
+    BenchMaster master;
+    std::vector<std::unique_ptr<Instrument>> ins(N);
+
+    auto ms = [](stc::steady_clock::duration d, uint count) -> f64 {
+        return stc::duration<f64, std::milli>(d).count() / count;
+    };
+
+    // the first one pays for what is computed once per process
+    stc::steady_clock::time_point t0 = stc::steady_clock::now();
+    ins[0].reset(new Instrument(master));
+    ins[0]->initialize(FS, B);
+    stc::steady_clock::time_point t1 = stc::steady_clock::now();
+    printf("First instrument:  %8.3f ms\n", ms(t1 - t0, 1));
+
+    t0 = stc::steady_clock::now();
+    for (uint i = 1; i < N; ++i)
+        ins[i].reset(new Instrument(master));
+    t1 = stc::steady_clock::now();
+    for (uint i = 1; i < N; ++i)
+        ins[i]->initialize(FS, B);
+    stc::steady_clock::time_point t2 = stc::steady_clock::now();
+    if (N > 1) {
+        printf("Construction:      %8.3f ms per instrument\n", ms(t1 - t0, N - 1));
+        printf("Initialization:    %8.3f ms per instrument\n", ms(t2 - t1, N - 1));
+    }
+
+    t0 = stc::steady_clock::now();
+    for (uint r = 0; r < R; ++r) {
+        for (uint i = 0; i < N; ++i)
+            ins[i]->reset();
+    }
+    t1 = stc::steady_clock::now();
+    if (R > 0)
+        printf("Reset:             %8.3f ms per instrument\n", ms(t1 - t0, N * R));
+
+    t0 = stc::steady_clock::now();
+    ins.clear();
+    t1 = stc::steady_clock::now();
+    printf("Destruction:       %8.3f ms per instrument\n", ms(t1 - t0, N));
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "cws/component/lfo.h"
+#include "cws/component/rate_tables.h"
+#include "utility/arithmetic.h"
+#include "utility/types.h"
+#include <boost/lexical_cast.hpp>
+#include <getopt.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+using namespace cws80;
+
+namespace stc = std::chrono;
+
+f64 FS = 44100;
+uint B = 64;  // block size
+f64 D = 100;  // duration
+
+//
+static const char usage[] =
+    "Usage: bench-lfo [options]\n"
+    "   -f <sample-rate>           Set the sample rate\n"
+    "   -b <block-size>            Set the block size\n"
+    "   -d <duration>              Set the duration (in s)\n";
+
+// the generator before the block kernels, a switch per block and a pass
+//  to halve, and the noise of std::minstd_rand
+struct RefLfo {
+    u32 phase = 0;
+    std::minstd_rand noisernd;
+    void generate(i8 *outp, uint wav, u32 phi, uint n);
+};
+
+static i8 Ref_tri(uint i)
+{
+    int n = ((i < 64) ? i : 64) - ((i < 64) ? 0 : (i < 192) ? (i - 64) : 128) +
+            ((i < 192) ? 0 : (i - 192));
+    return (i8)lrint(n * 127.0 / 64);
+}
+
+void RefLfo::generate(i8 *outp, uint wav, u32 phi, uint n)
+{
+    switch ((LfoWave)wav) {
+    case LfoWave::TRI:
+        for (uint i = 0; i < n; ++i) {
+            outp[i] = Ref_tri(ix8(phase));
+            phase += phi;
+        }
+        break;
+    case LfoWave::SAW:
+        for (uint i = 0; i < n; ++i) {
+            uint saw = 255 - ix8(phase);
+            outp[i] = (int)(saw * 254 / 255) - 127;
+            phase += phi;
+        }
+        break;
+    case LfoWave::SQR:
+        for (uint i = 0; i < n; ++i) {
+            outp[i] = (phase < 0x80000000u) ? 0 : 127;
+            phase += phi;
+        }
+        break;
+    case LfoWave::NOI:
+        for (uint i = 0; i < n; ++i) {
+            uint noi = noisernd() % 255;
+            outp[i] = (int)noi - 127;
+            phase += phi;
+        }
+        break;
+    }
+    for (uint i = 0; i < n; ++i)
+        outp[i] /= 2;
+}
+
+static const char *const wave_names[] = {"TRI", "SAW", "SQR", "NOI"};
+// keeps the outputs from being optimized out
+static volatile int Sink;
+
+int main(int argc, char *argv[])
+{
+    for (int c; (c = getopt(argc, argv, "hf:b:d:")) != -1;) {
+        switch (c) {
+        case 'h':
+            fputs(usage, stderr);
+            return 1;
+        case 'f':
+            FS = boost::lexical_cast<f64>(optarg);
+            break;
+        case 'b':
+            B = boost::lexical_cast<uint>(optarg);
+            if (B <= 0)
+                throw std::logic_error("invalid block size parameter");
+            break;
+        case 'd':
+            D = boost::lexical_cast<f64>(optarg);
+            if (D <= 0)
+                throw std::logic_error("invalid duration parameter");
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    if (argc != optind)
+        exit(1);
+
+    scoped_fesetround(FE_TONEAREST);
+    const RateTables &rt = rate_tables(FS);
+    uint nblocks = (uint)(D * FS / B);
+    std::vector<i8> out(B), ref(B);
+    bool ok = true;
+
+    for (uint wav = 0; wav < 4; ++wav) {
+        Lfo::Param param{};
+        param.WAV = wav;
+
+        // the same frames, over all the frequencies
+        uint mismatches = 0;
+        int lo = 0, hi = 0;
+        f64 sum = 0;
+        for (uint freq = 0; freq < 64; ++freq) {
+            param.FREQ = freq;
+            Lfo lfo;
+            lfo.initialize(FS, B);
+            lfo.setparam(&param);
+            lfo.setseed(freq);
+            RefLfo reflfo;
+            for (uint b = 0; b < 1000; ++b) {
+                lfo.generate(out.data(), nullptr, B);
+                reflfo.generate(ref.data(), wav, rt.lfo_phi[freq], B);
+                for (uint i = 0; i < B; ++i) {
+                    if ((LfoWave)wav != LfoWave::NOI)
+                        mismatches += out[i] != ref[i];
+                    lo = std::min<int>(lo, out[i]);
+                    hi = std::max<int>(hi, out[i]);
+                    sum += out[i];
+                }
+            }
+        }
+        f64 mean = sum / (64.0 * 1000 * B);
+        bool good = mismatches == 0 && lo >= -63 && hi <= 63 &&
+                    ((LfoWave)wav != LfoWave::NOI || (lo == -63 && hi == 63 && fabs(mean) < 0.1));
+        ok = ok && good;
+
+        // the durations, at a frequency in the middle
+        param.FREQ = 32;
+        Lfo lfo;
+        lfo.initialize(FS, B);
+        lfo.setparam(&param);
+        RefLfo reflfo;
+        u32 phi = rt.lfo_phi[32];
+        int check = 0;
+
+        stc::steady_clock::time_point t0 = stc::steady_clock::now();
+        for (uint b = 0; b < nblocks; ++b) {
+            lfo.generate(out.data(), nullptr, B);
+            check += out[b % B];
+        }
+        stc::steady_clock::time_point t1 = stc::steady_clock::now();
+        for (uint b = 0; b < nblocks; ++b) {
+            reflfo.generate(ref.data(), wav, phi, B);
+            check += ref[b % B];
+        }
+        stc::steady_clock::time_point t2 = stc::steady_clock::now();
+
+        f64 frames = (f64)nblocks * B;
+        f64 ns = stc::duration<f64, std::nano>(t1 - t0).count() / frames;
+        f64 refns = stc::duration<f64, std::nano>(t2 - t1).count() / frames;
+        Sink = check;
+        printf("%s: %6.3f ns per frame, reference %6.3f ns, x%5.2f, range %d..%d, mean %+.3f: %s\n",
+               wave_names[wav], ns, refns, refns / ns, lo, hi, mean, good ? "OK" : "FAILED");
+    }
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+#include "cws/component/osc.h"
+#include "cws/component/rate_tables.h"
+#include "utility/arithmetic.h"
+#include "utility/types.h"
+#include <boost/lexical_cast.hpp>
+#include <getopt.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+using namespace cws80;
+
+namespace stc = std::chrono;
+
+f64 FS = 44100;
+uint B = 64;  // block size
+f64 D = 10;  // duration
+uint S = 0;  // frames between syncs, 0 if none
+
+//
+static const char usage[] =
+    "Usage: bench-osc [options]\n"
+    "   -f <sample-rate>           Set the sample rate\n"
+    "   -b <block-size>            Set the block size\n"
+    "   -d <duration>              Set the duration (in s)\n"
+    "   -s <period>                Set the frames between syncs\n";
+
+// the generator before the vector kernel, a frame at a time
+static int Ref_value(const Sample &sample, u32 index)
+{
+    return (int)sample.data[index] * 65534 / 255 - 32767;
+}
+
+static int Ref_interpolate(Quality q, const Sample &sample, u32 phase)
+{
+    uint length = 1 << sample.log2length;
+    uint mask = length - 1;
+    uint shift = 32 - sample.log2length;
+    u32 i0 = phase >> shift;
+    uint frac = (phase >> (shift - 16)) & 65535;
+
+    switch (q) {
+    case Quality::Eco:
+        return Ref_value(sample, i0);
+    default:
+    case Quality::Normal: {
+        u32 i1 = (i0 < length - 1) ? (i0 + 1) : 0;
+        int s0 = Ref_value(sample, i0);
+        int s1 = Ref_value(sample, i1);
+        return ix16(s1 * (i32)frac + s0 * (i32)(65536 - frac));
+    }
+    case Quality::High: {
+        f32 y[4];
+        for (uint k = 0; k < 4; ++k)
+            y[k] = Ref_value(sample, (i0 + k - 1) & mask);
+        f32 mu = frac * (1.0f / 65536);
+        return clamp<int>(lrintf(itp_catmull(y, mu)), -32767, 32767);
+    }
+    }
+}
+
+static u32 Ref_generate(Quality q, const Sample &sample, u32 phase, u32 phaseinc,
+                        i16 *outp, const i8 *syncinp, i8 *syncoutp, uint n)
+{
+    for (uint i = 0; i < n; ++i) {
+        bool syncd = syncinp[i] > 0;
+        u32 oldphase = phase;
+        phase = syncd ? 0 : (phase + phaseinc);
+        syncoutp[i] = syncd | (phase < oldphase);
+        outp[i] = Ref_interpolate(q, sample, phase);
+    }
+    return phase;
+}
+
+static const char *const quality_names[] = {"Eco", "Normal", "High"};
+// keeps the outputs from being optimized out
+static volatile int Sink;
+
+int main(int argc, char *argv[])
+{
+    for (int c; (c = getopt(argc, argv, "hf:b:d:s:")) != -1;) {
+        switch (c) {
+        case 'h':
+            fputs(usage, stderr);
+            return 1;
+        case 'f':
+            FS = boost::lexical_cast<f64>(optarg);
+            break;
+        case 'b':
+            B = boost::lexical_cast<uint>(optarg);
+            if (B <= 0)
+                throw std::logic_error("invalid block size parameter");
+            break;
+        case 'd':
+            D = boost::lexical_cast<f64>(optarg);
+            if (D <= 0)
+                throw std::logic_error("invalid duration parameter");
+            break;
+        case 's':
+            S = boost::lexical_cast<uint>(optarg);
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    if (argc != optind)
+        exit(1);
+
+    scoped_fesetround(FE_TONEAREST);
+    const RateTables &rt = rate_tables(FS);
+    uint nblocks = (uint)(D * FS / B);
+    std::minstd_rand prng;
+
+    // the sync input, periodic for timing, random for checking
+    uint nsync = B * 16;
+    std::vector<i8> sync(nsync), randsync(nsync);
+    for (uint i = 0; i < nsync; ++i) {
+        sync[i] = S && (i % S) == S - 1;
+        randsync[i] = (prng() % 16) == 0;
+    }
+
+    std::vector<i16> out(B), ref(B);
+    std::vector<i8> syncout(B), refsyncout(B);
+    bool ok = true;
+
+    // the sizes of the wave ROM and one past them
+    for (uint log2length = 8; log2length <= 15; ++log2length) {
+        std::vector<u8> data(1u << log2length);
+        for (u8 &x : data)
+            x = prng() & 255;
+        Sample sample{data.data(), log2length};
+
+        for (uint q = 0; q < 3; ++q) {
+            Quality quality = (Quality)q;
+
+            // the same frames, over all the keys, with and without sync
+            uint mismatches = 0;
+            for (uint key = 0; key < 128; ++key) {
+                u32 phaseinc = rt.osc_phi[key * osc_phi_oversample];
+                for (const std::vector<i8> *syncinp : {&sync, &randsync}) {
+                    u32 phase = prng(), refphase = phase;
+                    for (uint b = 0; b < 16; ++b) {
+                        const i8 *sin = &(*syncinp)[b * B % nsync];
+                        phase = Osc::generate_wave(quality, sample, phase, phaseinc,
+                                                   out.data(), sin, syncout.data(), B);
+                        refphase = Ref_generate(quality, sample, refphase, phaseinc,
+                                                ref.data(), sin, refsyncout.data(), B);
+                        for (uint i = 0; i < B; ++i)
+                            mismatches += out[i] != ref[i] || syncout[i] != refsyncout[i];
+                    }
+                    mismatches += phase != refphase;
+                }
+            }
+            bool good = mismatches == 0;
+            ok = ok && good;
+
+            // the durations, at the middle key
+            u32 phaseinc = rt.osc_phi[60 * osc_phi_oversample];
+            u32 phase = 0, refphase = 0;
+            int check = 0;
+
+            stc::steady_clock::time_point t0 = stc::steady_clock::now();
+            for (uint b = 0; b < nblocks; ++b) {
+                const i8 *sin = &sync[b * B % nsync];
+                phase = Osc::generate_wave(quality, sample, phase, phaseinc,
+                                           out.data(), sin, syncout.data(), B);
+                check += out[b % B];
+            }
+            stc::steady_clock::time_point t1 = stc::steady_clock::now();
+            for (uint b = 0; b < nblocks; ++b) {
+                const i8 *sin = &sync[b * B % nsync];
+                refphase = Ref_generate(quality, sample, refphase, phaseinc,
+                                        ref.data(), sin, refsyncout.data(), B);
+                check += ref[b % B];
+            }
+            stc::steady_clock::time_point t2 = stc::steady_clock::now();
+
+            f64 frames = (f64)nblocks * B;
+            f64 ns = stc::duration<f64, std::nano>(t1 - t0).count() / frames;
+            f64 refns = stc::duration<f64, std::nano>(t2 - t1).count() / frames;
+            Sink = check;
+            printf("2^%-2u %-6s: %6.3f ns per frame, reference %6.3f ns, x%5.2f: %s\n",
+                   log2length, quality_names[q], ns, refns, refns / ns,
+                   good ? "OK" : "FAILED");
+        }
+    }
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
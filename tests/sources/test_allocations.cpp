@@ -0,0 +1,179 @@
+#include "cws/cws80_ins.h"
+#include "cws/cws80_messages.h"
+#include "utility/types.h"
+#include <boost/lexical_cast.hpp>
+#include <getopt.h>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+using namespace cws80;
+
+f64 FS = 44100;
+uint B = 256;  // block size
+uint N = 2000;  // number of blocks
+
+//
+static const char usage[] =
+    "Usage: test-allocations [options]\n"
+    "   -f <sample-rate>           Set the sample rate\n"
+    "   -b <block-size>            Set the block size\n"
+    "   -n <count>                 Set the number of blocks\n";
+
+// the hook: counts the allocations made while armed, by the audio thread
+static thread_local bool Alloc_armed = false;
+static std::atomic<u64> Alloc_count{0};
+
+static void *Alloc_new(size_t size)
+{
+    if (Alloc_armed)
+        Alloc_count.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new(size_t size) { return Alloc_new(size); }
+void *operator new[](size_t size) { return Alloc_new(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+//
+struct TestMaster : FxMaster {
+    bool emit_notification(const Notification::T &) override { return true; }
+};
+
+int main(int argc, char *argv[])
+{
+    for (int c; (c = getopt(argc, argv, "hf:b:n:")) != -1;) {
+        switch (c) {
+        case 'h':
+            fputs(usage, stderr);
+            return 1;
+        case 'f':
+            FS = boost::lexical_cast<f64>(optarg);
+            break;
+        case 'b':
+            B = boost::lexical_cast<uint>(optarg);
+            if (B <= 0)
+                throw std::logic_error("invalid block size parameter");
+            break;
+        case 'n':
+            N = boost::lexical_cast<uint>(optarg);
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    if (argc != optind)
+        exit(1);
+
+    TestMaster master;
+    std::unique_ptr<Instrument> ins(new Instrument(master));
+    ins->initialize(FS, B);
+    ins->set_multitimbral(true);
+    ins->set_polyphony(polymax);
+    ins->set_voice_budget(0.5f);
+
+    std::vector<i16> outl(B), outr(B);
+    std::vector<MidiEvent> events;
+    std::vector<u8> msgs;
+    events.reserve(64);
+    msgs.reserve(64 * 3);
+    std::minstd_rand prng;
+
+    // everything which may happen after initialization, at random
+    Alloc_armed = true;
+    for (uint n = 0; n < N; ++n) {
+        events.clear();
+        msgs.clear();
+        uint count = std::uniform_int_distribution<uint>(0, 16)(prng);
+        uint ftime = 0;
+        for (uint i = 0; i < count; ++i) {
+            u8 status;
+            switch (std::uniform_int_distribution<uint>(0, 9)(prng)) {
+            default: status = 0x90; break;
+            case 4: case 5: status = 0x80; break;
+            case 6: status = 0xb0; break;
+            case 7: status = 0xe0; break;
+            case 8: status = 0xa0; break;
+            case 9: status = 0xc0; break;
+            }
+            status |= prng() % 4;
+            u8 data1 = prng() % 128;
+            u8 data2 = prng() % 128;
+            if ((status & 0xf0) == 0xb0)
+                data1 = (prng() & 1) ? 1 : 4;
+            ftime = std::uniform_int_distribution<uint>(ftime, B - 1)(prng);
+            size_t off = msgs.size();
+            msgs.push_back(status);
+            msgs.push_back(data1);
+            msgs.push_back(data2);
+            uint len = ((status & 0xf0) == 0xc0) ? 2 : 3;
+            events.push_back(MidiEvent{ftime, len, &msgs[off]});
+        }
+
+        switch (prng() % 17) {
+        case 0: {
+            Request::SetParameter req;
+            req.index = prng() % Param::num_params;
+            req.value = ins->get_parameter(req.index);
+            ins->receive_request(req);
+            break;
+        }
+        case 1:
+            ins->set_parameter(P_Misc_FLTFC, prng() % 128);
+            break;
+        case 2:
+            ins->set_parameter_ramp(P_Misc_FLTFC, B / 2);
+            ins->automate_parameter(P_Misc_FLTFC, prng() % 128, prng() % B);
+            break;
+        case 3: {
+            Request::SetProgram req;
+            req.prog = prng() % 128;
+            ins->receive_request(req);
+            break;
+        }
+        case 4:
+            ins->receive_request(Request::WriteProgram());
+            break;
+        case 5:
+            ins->set_polyphony(1 + prng() % polymax);
+            break;
+        case 6:
+            ins->set_quality((Quality)(prng() % 3));
+            break;
+        case 7:
+            ins->receive_request(Request::InitProgram());
+            break;
+        case 8: {
+            Request::NoteOn req;
+            req.key = prng() % 128;
+            req.velocity = 1 + prng() % 127;
+            ins->receive_request(req);
+            break;
+        }
+        case 9:
+            ins->set_shared_lfos(!ins->shared_lfos());
+            break;
+        }
+
+        ins->synthesize(outl.data(), outr.data(), B, events.data(), events.size());
+    }
+    ins->reset();
+    ins->synthesize(outl.data(), outr.data(), B, nullptr, 0);
+    Alloc_armed = false;
+
+    u64 allocs = Alloc_count.load();
+    printf("Allocations after initialization: %llu in %u blocks\n",
+           (unsigned long long)allocs, N);
+    printf("%s\n", (allocs == 0) ? "OK" : "FAILED");
+    return (allocs == 0) ? 0 : 1;
+}
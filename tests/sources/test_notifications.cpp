@@ -0,0 +1,170 @@
+#include "cws/cws80_ins.h"
+#include "cws/cws80_messages.h"
+#include "plugin/plug_requests.h"
+#include "ring_buffer.h"
+#include "utility/container/slot_queue.h"
+#include "utility/types.h"
+#include <boost/lexical_cast.hpp>
+#include <getopt.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+using namespace cws80;
+
+namespace stc = std::chrono;
+
+f64 FS = 44100;
+uint B = 256;  // block size
+f64 I = 30;  // idle rate of the UI
+uint L = 5;  // number of bank loads
+bool One = false;  // one notification per idle
+
+static void process();
+
+//
+static const char usage[] =
+    "Usage: test-notifications [options]\n"
+    "   -f <sample-rate>           Set the sample rate\n"
+    "   -b <block-size>            Set the block size\n"
+    "   -i <rate>                  Set the idle rate of the UI (in Hz)\n"
+    "   -l <loads>                 Set the number of bank loads\n"
+    "   -1                         Take one notification per idle\n";
+
+//
+struct TestMaster : FxMaster {
+    Ring_Buffer *out = nullptr;
+    bool emit_notification(const Notification::T &ntf) override
+    {
+        NotificationTraits tr(ntf.type);
+        return out->put(reinterpret_cast<const u8 *>(&ntf), tr.size());
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    for (int c; (c = getopt(argc, argv, "hf:b:i:l:1")) != -1;) {
+        switch (c) {
+        case 'h':
+            fputs(usage, stderr);
+            return 1;
+        case 'f':
+            FS = boost::lexical_cast<f64>(optarg);
+            break;
+        case 'b':
+            B = boost::lexical_cast<uint>(optarg);
+            if (B <= 0)
+                throw std::logic_error("invalid block size parameter");
+            break;
+        case 'i':
+            I = boost::lexical_cast<f64>(optarg);
+            if (I <= 0)
+                throw std::logic_error("invalid idle rate parameter");
+            break;
+        case 'l':
+            L = boost::lexical_cast<uint>(optarg);
+            break;
+        case '1':
+            One = true;
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    if (argc != optind)
+        exit(1);
+
+    process();
+    return 0;
+}
+
+// the audio thread, one cycle every block duration
+static void run_audio(Instrument &ins, Ring_Buffer &requests, std::atomic<bool> &stop)
+{
+    std::vector<i16> outl(B), outr(B);
+    auto schedule = [](const Request::T &) -> bool { return true; };
+
+    stc::steady_clock::time_point start = stc::steady_clock::now();
+    for (uint i = 0; !stop.load(); ++i) {
+        std::this_thread::sleep_until(start + stc::duration<f64>(i * B / FS));
+        receive_requests(requests, ins, 32768, schedule);
+        ins.synthesize(outl.data(), outr.data(), B, nullptr, 0);
+    }
+}
+
+static void process()
+{
+    Ring_Buffer requests(65536);
+    Ring_Buffer notifications(65536);
+    slot_queue<NotificationTraits::max_size(), 64> slots;
+
+    TestMaster master;
+    master.out = &notifications;
+    std::unique_ptr<Instrument> ins(new Instrument(master));
+    ins->initialize(FS, B);
+
+    std::atomic<bool> stop{false};
+    std::thread audio(run_audio, std::ref(*ins), std::ref(requests), std::ref(stop));
+
+    // the idle routine of the UI, which returns the banks completed
+    auto idle = [&]() -> uint {
+        uint completed = 0;
+        for (Notification::T hdr; notifications.peek(hdr);) {
+            Notification::T *slot = static_cast<Notification::T *>(slots.back());
+            if (!slot)
+                break;
+            NotificationTraits tr(hdr.type);
+            notifications.get(reinterpret_cast<u8 *>(slot), tr.size());
+            slots.push();
+            if (One)
+                break;
+        }
+        while (const void *slot = slots.front()) {
+            const Notification::T &ntf = *static_cast<const Notification::T *>(slot);
+            if (ntf.type == NotificationType::BankSlots)
+                completed += static_cast<const Notification::BankSlots &>(ntf).last;
+            slots.pop();
+        }
+        return completed;
+    };
+
+    stc::duration<f64> tick(1 / I);
+    stc::steady_clock::time_point start = stc::steady_clock::now();
+
+    // the 4 banks at startup
+    uint ticks = 0;
+    for (uint banks = 0; banks < 4; ++ticks) {
+        std::this_thread::sleep_until(start + ticks * tick);
+        banks += idle();
+    }
+    f64 startup = stc::duration<f64>(stc::steady_clock::now() - start).count();
+
+    f64 total = 0;
+    for (uint l = 0; l < L; ++l) {
+        Bank *bank = ins->bank_pool().acquire();
+        *bank = ins->bank((l + 1) % 4);
+        Request::LoadBank req;
+        req.index = ins->bank_pool().index_of(bank);
+
+        start = stc::steady_clock::now();
+        requests.put(reinterpret_cast<const u8 *>(&req), sizeof(req));
+        ticks = 0;
+        for (uint banks = 0; banks < 1; ++ticks) {
+            std::this_thread::sleep_until(start + ticks * tick);
+            banks += idle();
+        }
+        total += stc::duration<f64>(stc::steady_clock::now() - start).count();
+    }
+
+    stop.store(true);
+    audio.join();
+
+    printf("UI idle at %.0f Hz, %s\n", I, One ? "one notification per idle" : "all notifications per idle");
+    printf("Startup banks: %.3f ms\n", startup * 1e3);
+    printf("Bank load: %.3f ms on average\n", total / L * 1e3);
+}
@@ -0,0 +1,192 @@
+#include "cws/cws80_ins.h"
+#include "cws/cws80_messages.h"
+#include "plugin/plug_requests.h"
+#include "ring_buffer.h"
+#include "utility/types.h"
+#include <boost/lexical_cast.hpp>
+#include <getopt.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+using namespace cws80;
+
+namespace stc = std::chrono;
+
+f64 FS = 44100;
+uint B = 256;  // block size
+f64 D = 5;  // duration
+uint R = 20;  // parameter changes per ms
+size_t Budget = 32768;  // bytes of requests per cycle
+
+static bool process();
+
+//
+static const char usage[] =
+    "Usage: test-requests [options]\n"
+    "   -f <sample-rate>           Set the sample rate\n"
+    "   -b <block-size>            Set the block size\n"
+    "   -d <duration>              Set the duration (in s)\n"
+    "   -r <rate>                  Set the parameter changes per ms\n"
+    "   -m <bytes>                 Set the bytes of requests per cycle\n";
+
+//
+struct TestMaster : FxMaster {
+    bool emit_notification(const Notification::T &) override { return true; }
+};
+
+int main(int argc, char *argv[])
+{
+    for (int c; (c = getopt(argc, argv, "hf:b:d:r:m:")) != -1;) {
+        switch (c) {
+        case 'h':
+            fputs(usage, stderr);
+            return 1;
+        case 'f':
+            FS = boost::lexical_cast<f64>(optarg);
+            break;
+        case 'b':
+            B = boost::lexical_cast<uint>(optarg);
+            if (B <= 0)
+                throw std::logic_error("invalid block size parameter");
+            break;
+        case 'd':
+            D = boost::lexical_cast<f64>(optarg);
+            if (D <= 0)
+                throw std::logic_error("invalid duration parameter");
+            break;
+        case 'r':
+            R = boost::lexical_cast<uint>(optarg);
+            break;
+        case 'm':
+            Budget = boost::lexical_cast<size_t>(optarg);
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    if (argc != optind)
+        exit(1);
+
+    return process() ? 0 : 1;
+}
+
+// the user interface, which drags knobs and plays a note every 10 ms
+//  sending is retried later when the queue is full, like the plugin UI
+static void flood(Ring_Buffer &rb, std::atomic<bool> &stop, std::atomic<bool> &done,
+                  i32 last[2], uint &sent)
+{
+    static const uint params[2] = {P_Misc_FLTFC, P_Misc_Q};
+    std::vector<Request::SetParameter> pending;
+    uint tick = 0;
+
+    for (; !stop.load(); ++tick) {
+        for (uint i = 0; i < R; ++i) {
+            uint which = (i * 2 / std::max(R, 1u)) & 1;
+            Request::SetParameter req;
+            req.index = params[which];
+            req.value = (tick + i) % ((which == 0) ? 128 : 32);
+            last[which] = req.value;
+            pending.push_back(req);
+        }
+
+        size_t n = 0;
+        for (; n < pending.size() && rb.put(pending[n]); ++n)
+            ++sent;
+        pending.erase(pending.begin(), pending.begin() + n);
+
+        if (tick % 10 == 0 && pending.empty()) {
+            Request::NoteOn on;
+            on.key = 60;
+            on.velocity = 100;
+            on.time = request_time();
+            Request::NoteOff off;
+            off.key = 60;
+            off.velocity = 0;
+            off.time = on.time;
+            sent += rb.put(on);
+            sent += rb.put(off);
+        }
+
+        std::this_thread::sleep_for(stc::milliseconds(1));
+    }
+
+    // flush what remains
+    for (const Request::SetParameter &req : pending) {
+        while (!rb.put(req))
+            std::this_thread::yield();
+        ++sent;
+    }
+    done.store(true);
+}
+
+static bool process()
+{
+    TestMaster master;
+    std::unique_ptr<Instrument> ins(new Instrument(master));
+    ins->initialize(FS, B);
+    ins->select_program(0, 0);
+
+    Ring_Buffer rb(65536);
+    std::atomic<bool> stop{false}, done{false};
+    i32 last[2] = {-1, -1};
+    uint sent = 0;
+    std::thread ui(flood, std::ref(rb), std::ref(stop), std::ref(done), last, std::ref(sent));
+
+    std::vector<i16> outl(B), outr(B);
+    std::vector<f64> latencies;
+    size_t backlog = 0;
+    uint notes = 0;
+
+    auto schedule = [&](const Request::T &req) -> bool {
+        u64 time = (req.type == RequestType::NoteOn) ?
+            ((const Request::NoteOn &)req).time : ((const Request::NoteOff &)req).time;
+        latencies.push_back((request_time() - time) * 1e-6);
+        ins->receive_request(req);
+        ++notes;
+        return true;
+    };
+
+    // the audio thread, one cycle every block duration
+    uint ncycles = (uint)(D * FS / B);
+    stc::steady_clock::time_point start = stc::steady_clock::now();
+    for (uint i = 0; i < ncycles; ++i) {
+        std::this_thread::sleep_until(start + stc::duration<f64>(i * B / FS));
+        backlog = std::max(backlog, rb.size_used());
+        receive_requests(rb, *ins, Budget, schedule);
+        ins->synthesize(outl.data(), outr.data(), B, nullptr, 0);
+    }
+
+    // receive the rest, while the user interface flushes
+    stop.store(true);
+    while (!done.load() || rb.size_used() > 0)
+        receive_requests(rb, *ins, Budget, schedule);
+    ui.join();
+    ins->synthesize(outl.data(), outr.data(), B, nullptr, 0);
+
+    std::sort(latencies.begin(), latencies.end());
+    f64 lmax = latencies.empty() ? 0 : latencies.back();
+    f64 l99 = latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100];
+    f64 lmed = latencies.empty() ? 0 : latencies[latencies.size() / 2];
+
+    printf("Cycles: %u of %u frames, budget %zu bytes\n", ncycles, B, Budget);
+    printf("Requests: %u sent, %u notes, backlog up to %zu bytes\n", sent, notes, backlog);
+    printf("Latency: median %.3f ms, 99%% %.3f ms, max %.3f ms\n", lmed, l99, lmax);
+
+    // the last value of each parameter is the one which remains
+    bool ok = true;
+    if (ins->get_parameter(P_Misc_FLTFC) != last[0]) {
+        printf("Cutoff %d, expected %d\n", ins->get_parameter(P_Misc_FLTFC), last[0]);
+        ok = false;
+    }
+    if (ins->get_parameter(P_Misc_Q) != last[1]) {
+        printf("Resonance %d, expected %d\n", ins->get_parameter(P_Misc_Q), last[1]);
+        ok = false;
+    }
+    return ok;
+}
@@ -0,0 +1,128 @@
+#include "cws/cws80_ins.h"
+#include "utility/types.h"
+#include <boost/lexical_cast.hpp>
+#include <getopt.h>
+#include <memory>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+using namespace cws80;
+
+f64 FS = 44100;
+uint B = 1024;  // block size
+uint P = 0;  // program number
+uint K = 60;  // key
+uint S = 37;  // step of offsets
+
+static bool process();
+
+//
+static const char usage[] =
+    "Usage: test-timing [options]\n"
+    "   -f <sample-rate>           Set the sample rate\n"
+    "   -b <block-size>            Set the block size\n"
+    "   -P <program>               Set the program number (0..127)\n"
+    "   -k <key>                   Set the key (0..127)\n"
+    "   -s <step>                  Set the step between tested offsets\n";
+
+//
+struct TestMaster : FxMaster {
+    bool emit_notification(const Notification::T &) override { return true; }
+};
+
+int main(int argc, char *argv[])
+{
+    for (int c; (c = getopt(argc, argv, "hf:b:P:k:s:")) != -1;) {
+        switch (c) {
+        case 'h':
+            fputs(usage, stderr);
+            return 1;
+        case 'f':
+            FS = boost::lexical_cast<f64>(optarg);
+            break;
+        case 'b':
+            B = boost::lexical_cast<uint>(optarg);
+            if (B < 2)
+                throw std::logic_error("invalid block size parameter");
+            break;
+        case 'P':
+            P = boost::lexical_cast<uint>(optarg);
+            if (P >= 128)
+                throw std::logic_error("invalid program parameter");
+            break;
+        case 'k':
+            K = boost::lexical_cast<uint>(optarg);
+            if (K >= 128)
+                throw std::logic_error("invalid key parameter");
+            break;
+        case 's':
+            S = boost::lexical_cast<uint>(optarg);
+            if (S <= 0)
+                throw std::logic_error("invalid step parameter");
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    if (argc != optind)
+        exit(1);
+
+    return process() ? 0 : 1;
+}
+
+// render two blocks, with a note-on at the given offset of the first one
+static std::vector<i16> render_note(uint offset)
+{
+    TestMaster master;
+    std::unique_ptr<Instrument> ins(new Instrument(master));
+    ins->initialize(FS, B);
+    ins->select_program(0, P);
+
+    std::vector<i16> outl(2 * B), outr(2 * B);
+
+    const u8 msg[3] = {0x90, (u8)K, 100};
+    MidiEvent ev{offset, 3, msg};
+    ins->synthesize(&outl[0], &outr[0], B, &ev, 1);
+    ins->synthesize(&outl[B], &outr[B], B, nullptr, 0);
+
+    return outl;
+}
+
+static bool process()
+{
+    std::vector<i16> ref = render_note(0);
+    uint reflen = 2 * B;
+
+    uint onset = 0;
+    while (onset < reflen && ref[onset] == 0)
+        ++onset;
+    if (onset == reflen) {
+        fprintf(stderr, "The note is silent.\n");
+        return false;
+    }
+    printf("Onset at frame %u for a note at frame 0\n", onset);
+
+    uint failures = 0;
+    for (uint offset = 1; offset < B; offset += S) {
+        std::vector<i16> out = render_note(offset);
+
+        // the output must be the reference, delayed by the exact offset
+        uint error = ~0u;
+        for (uint i = 0; i < 2 * B && error == ~0u; ++i) {
+            i16 expected = (i < offset) ? 0 : ref[i - offset];
+            if (out[i] != expected)
+                error = i;
+        }
+
+        if (error == ~0u)
+            printf("Offset %4u: OK\n", offset);
+        else {
+            printf("Offset %4u: mismatch at frame %u\n", offset, error);
+            ++failures;
+        }
+    }
+
+    return failures == 0;
+}
@@ -0,0 +1,250 @@
+#include "cws/cws80_ins.h"
+#include "cws/cws80_messages.h"
+#include "plugin/plug_requests.h"
+#include "plugin/plug_transport.h"
+#include "utility/types.h"
+#include <boost/lexical_cast.hpp>
+#include <getopt.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+using namespace cws80;
+
+namespace stc = std::chrono;
+
+f64 FS = 44100;
+uint B = 64;  // block size
+uint K = 200;  // number of round trips
+
+static int run_plugin(Transport &transport, pid_t ui);
+static int run_ui(const Transport::Id &id);
+
+//
+static const char usage[] =
+    "Usage: test-transport [options]\n"
+    "   -f <sample-rate>           Set the sample rate\n"
+    "   -b <block-size>            Set the block size\n"
+    "   -k <count>                 Set the number of parameter round trips\n";
+
+//
+struct TestMaster : FxMaster {
+    Shared_Ring_Buffer *out = nullptr;
+    bool emit_notification(const Notification::T &ntf) override
+    {
+        NotificationTraits tr(ntf.type);
+        return out->put(reinterpret_cast<const u8 *>(&ntf), tr.size());
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    for (int c; (c = getopt(argc, argv, "hf:b:k:")) != -1;) {
+        switch (c) {
+        case 'h':
+            fputs(usage, stderr);
+            return 1;
+        case 'f':
+            FS = boost::lexical_cast<f64>(optarg);
+            break;
+        case 'b':
+            B = boost::lexical_cast<uint>(optarg);
+            if (B <= 0)
+                throw std::logic_error("invalid block size parameter");
+            break;
+        case 'k':
+            K = boost::lexical_cast<uint>(optarg);
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    if (argc != optind)
+        exit(1);
+
+    Transport transport;
+    if (!transport.create()) {
+        fprintf(stderr, "Cannot create the transport\n");
+        return 1;
+    }
+    printf("Transport \"%s\", %zu bytes\n", transport.name().c_str(), sizeof(Transport::Layout));
+    fflush(stdout);
+
+    // the name with the token of another instance, as a saved session has
+    Transport::Id stale = transport.id();
+    stale.token ^= 1;
+    Transport other;
+    if (other.open(stale)) {
+        fprintf(stderr, "The transport opens with the token of another instance\n");
+        return 1;
+    }
+
+    // the user interface is a separate process, which knows only the numbers
+    pid_t ui = fork();
+    if (ui == -1) {
+        perror("fork");
+        return 1;
+    }
+    if (ui == 0) {
+        int ret = run_ui(transport.id());
+        fflush(stdout);
+        _exit(ret);
+    }
+
+    return run_plugin(transport, ui);
+}
+
+// the audio side, one cycle every block duration, until the UI exits
+static int run_plugin(Transport &transport, pid_t ui)
+{
+    Transport::Layout &shared = *transport.layout();
+    TestMaster master;
+    master.out = &shared.notifications;
+    std::unique_ptr<Instrument> ins(new Instrument(master, &shared.banks));
+    ins->initialize(FS, B);
+
+    std::vector<i16> outl(B), outr(B);
+    auto schedule = [&](const Request::T &req) -> bool {
+        ins->receive_request(req);
+        return true;
+    };
+
+    int status = -1;
+    stc::steady_clock::time_point start = stc::steady_clock::now();
+    for (uint i = 0; waitpid(ui, &status, WNOHANG) == 0; ++i) {
+        if (stc::steady_clock::now() - start > stc::seconds(30)) {
+            kill(ui, SIGKILL);
+            waitpid(ui, &status, 0);
+            fprintf(stderr, "The UI did not finish in time\n");
+            return 1;
+        }
+        std::this_thread::sleep_until(start + stc::duration<f64>(i * B / FS));
+        receive_requests(shared.requests, *ins, 32768, schedule);
+        ins->synthesize(outl.data(), outr.data(), B, nullptr, 0);
+    }
+
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (ok && strncmp(ins->bank(0).pgm[0].NAME, "SHMTST", 6) != 0) {
+        fprintf(stderr, "The loaded bank is not installed\n");
+        ok = false;
+    }
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+// the user interface stub, which sleeps until notified
+static int run_ui(const Transport::Id &id)
+{
+    Transport transport;
+    if (!transport.open(id)) {
+        fprintf(stderr, "Cannot open the transport\n");
+        return 1;
+    }
+
+    Transport::Layout &shared = *transport.layout();
+    BankPool pool(&shared.banks);
+    std::unique_ptr<Bank[]> banks(new Bank[4]());
+    alignas(Notification::T) u8 data[NotificationTraits::max_size()];
+    const Notification::T &ntf = *reinterpret_cast<const Notification::T *>(data);
+
+    // receive notifications until the predicate is true, or the time is out
+    auto receive_until = [&](stc::milliseconds timeout, auto &&pred) -> bool {
+        stc::steady_clock::time_point end = stc::steady_clock::now() + timeout;
+        for (;;) {
+            for (Notification::T hdr; shared.notifications.peek(hdr);) {
+                NotificationTraits tr(hdr.type);
+                if (!shared.notifications.get(data, tr.size()))
+                    break;
+                if (ntf.type == NotificationType::BankSlots) {
+                    auto &slots = static_cast<const Notification::BankSlots &>(ntf);
+                    Bank &bank = banks[slots.num];
+                    bank.pgm_count = slots.pgm_count;
+                    for (uint i = 0; i < slots.count; ++i)
+                        bank.pgm[slots.slot[i]] = slots.pgm[i];
+                }
+                if (pred(ntf))
+                    return true;
+            }
+            stc::steady_clock::time_point now = stc::steady_clock::now();
+            if (now >= end)
+                return false;
+            u32 ms = stc::duration_cast<stc::milliseconds>(end - now).count();
+            shared.notifications.wait(std::max<u32>(ms, 1));
+        }
+    };
+
+    stc::steady_clock::time_point start = stc::steady_clock::now();
+    uint complete = 0;
+    receive_until(stc::milliseconds(5000), [&](const Notification::T &ntf) -> bool {
+        if (ntf.type == NotificationType::BankSlots)
+            complete += static_cast<const Notification::BankSlots &>(ntf).last;
+        return complete == 4;
+    });
+    if (complete != 4) {
+        fprintf(stderr, "The banks did not arrive\n");
+        return 1;
+    }
+    printf("Startup banks: %.3f ms\n", stc::duration<f64>(stc::steady_clock::now() - start).count() * 1e3);
+
+    // load a bank, written in place in the shared pool
+    Bank *bank = pool.acquire();
+    if (!bank) {
+        fprintf(stderr, "No bank is available\n");
+        return 1;
+    }
+    *bank = banks[1];
+    bank->pgm[0].rename("SHMTST");
+    Request::LoadBank load;
+    load.index = pool.index_of(bank);
+    start = stc::steady_clock::now();
+    shared.requests.put(load);
+    bool loaded = receive_until(stc::milliseconds(5000), [&](const Notification::T &ntf) -> bool {
+        if (ntf.type != NotificationType::BankSlots)
+            return false;
+        auto &slots = static_cast<const Notification::BankSlots &>(ntf);
+        return slots.num == 0 && slots.last;
+    });
+    if (!loaded || strncmp(banks[0].pgm[0].NAME, "SHMTST", 6) != 0) {
+        fprintf(stderr, "The bank did not load\n");
+        return 1;
+    }
+    printf("Bank load: %.3f ms\n", stc::duration<f64>(stc::steady_clock::now() - start).count() * 1e3);
+
+    // parameter round trips, a request and the notification of the change
+    std::vector<f64> trips;
+    for (uint k = 0; k < K; ++k) {
+        Request::SetParameter set;
+        set.index = P_Misc_FLTFC;
+        set.value = (k & 1) ? 100 : 20;
+        start = stc::steady_clock::now();
+        shared.requests.put(set);
+        bool changed = receive_until(stc::milliseconds(1000), [&](const Notification::T &ntf) -> bool {
+            if (ntf.type != NotificationType::Parameters)
+                return false;
+            auto &params = static_cast<const Notification::Parameters &>(ntf);
+            for (uint i = 0; i < params.count; ++i) {
+                if (params.index[i] == set.index && params.value[i] == set.value)
+                    return true;
+            }
+            return false;
+        });
+        if (!changed) {
+            fprintf(stderr, "The parameter did not change\n");
+            return 1;
+        }
+        trips.push_back(stc::duration<f64>(stc::steady_clock::now() - start).count() * 1e3);
+    }
+    std::sort(trips.begin(), trips.end());
+    if (!trips.empty())
+        printf("Parameter round trip: median %.3f ms, max %.3f ms, block %.3f ms\n",
+               trips[trips.size() / 2], trips.back(), B / FS * 1e3);
+
+    return 0;
+}